@@ -0,0 +1,158 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGN  (8)
+
+void arenaInit(arena_t *arena, void *memory, size_t size) {
+  arena->base = memory;
+  arena->size = size;
+  arena->peak = 0;
+  arenaReset(arena);
+}
+
+void arenaReset(arena_t *arena) {
+  arena->used = 0;
+  arena->reserved = 0;
+  arena->paths = 0;
+}
+
+static void arenaUse(arena_t *arena, size_t size) {
+  arena->used += size;
+  if (arena->used > arena->peak) {
+    arena->peak = arena->used;
+  }
+}
+
+/*
+ * General allocations are aligned to ARENA_ALIGN. Returns NULL when the
+ * arena is full.
+ */
+void *arenaAlloc(arena_t *arena, size_t size) {
+  size_t start = (arena->used + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  if (start > arena->size || size > arena->size - start) {
+    return NULL;
+  }
+  arena->used = start;
+  arenaUse(arena, size);
+  return arena->base + start;
+}
+
+/*
+ * Scratch memory for the length of one call, taken from the top of the
+ * free space so that paths stored meanwhile still pack from the bottom.
+ * The arena's size shrinks until arenaEndScratch() puts back the size
+ * saved in mark. Scratch is given back in the reverse order it was
+ * taken. Returns NULL when it does not fit.
+ */
+void *arenaBeginScratch(arena_t *arena, size_t size, size_t *mark) {
+  size_t start;
+  if (size > arena->size - arena->used) {
+    return NULL;
+  }
+  start = (arena->size - size) & ~(size_t) (ARENA_ALIGN - 1);
+  if (start < arena->used) {
+    return NULL;
+  }
+  *mark = arena->size;
+  if (arena->used + (arena->size - start) > arena->peak) {
+    arena->peak = arena->used + (arena->size - start);
+  }
+  arena->size = start;
+  return arena->base + start;
+}
+
+void arenaEndScratch(arena_t *arena, size_t mark) {
+  arena->size = mark;
+}
+
+/*
+ * Point the command buffer at the free end of the arena. A path is never
+ * given more room than commandList would have, so no path can be longer
+ * in an arena than out of one.
+ */
+int arenaBeginPath(arena_t *arena) {
+  size_t room = arena->size - arena->used;
+  if (room > COMMAND_LIST_SIZE) {
+    room = COMMAND_LIST_SIZE;
+  }
+  arena->reserved = room;
+  if (room < 2) {
+    setCommandBuffer(NULL, 0);
+    return -1;
+  }
+  setCommandBuffer((COMMAND *) (arena->base + arena->used), (int) room);
+  return 0;
+}
+
+/*
+ * Keep the commands emitted since arenaBeginPath() and put the command
+ * buffer back to commandList. Lists are one byte per command and are
+ * packed end to end. A list that filled all its room is kept only if its
+ * last command is the CMD_STOP; otherwise commands were lost past the end.
+ */
+int arenaEndPath(arena_t *arena, pathResult_t *path) {
+  size_t n = commandCount();
+  COMMAND *commands = (COMMAND *) (arena->base + arena->used);
+  size_t reserved = arena->reserved;
+  setCommandBuffer(NULL, 0);
+  arena->reserved = 0;
+  if (reserved < 2 || n > reserved || (n == reserved && commands[n - 1] != CMD_STOP)) {
+    return -1;
+  }
+  if (n == 0 || commands[n - 1] != CMD_STOP) {
+    commands[n++] = CMD_STOP;
+  }
+  path->commands = commands;
+  path->length = (int) n - 1;
+  arenaUse(arena, n);
+  arena->paths++;
+  return 0;
+}
+
+/*
+ * Copy a terminated list, such as commandList after a peephole pass,
+ * into the arena. A list with no CMD_STOP in its first COMMAND_LIST_SIZE
+ * commands would not fit in commandList either, so it is not stored and
+ * -1 is returned, as it is when the arena is full.
+ */
+int arenaStorePath(arena_t *arena, const COMMAND *list, pathResult_t *path) {
+  size_t n = 0;
+  COMMAND *commands;
+  while (n < COMMAND_LIST_SIZE && list[n] != CMD_STOP) {
+    n++;
+  }
+  if (n == COMMAND_LIST_SIZE || arena->size - arena->used < n + 1) {
+    return -1;
+  }
+  commands = (COMMAND *) (arena->base + arena->used);
+  memcpy(commands, list, n);
+  commands[n] = CMD_STOP;
+  path->commands = commands;
+  path->length = (int) n;
+  arenaUse(arena, n + 1);
+  arena->paths++;
+  return 0;
+}
@@ -0,0 +1,85 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef ARENA_H
+#define	ARENA_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "commands.h"
+
+  /*
+   * A bump allocator for keeping many command lists in memory at once.
+   * Each list takes only the commands it needs, where commandList always
+   * takes COMMAND_LIST_SIZE, so a batch of typical paths is a few percent
+   * of the size and is read back through far fewer cache lines.
+   *
+   * The arena never allocates. The caller hands it a block of memory,
+   * usually once per thread at start up, and resets it between batches,
+   * which frees every path in it at once. Handles into an arena are not
+   * valid after a reset.
+   *
+   * To generate a path in place, bracket the generator with
+   * arenaBeginPath() and arenaEndPath(). In between, emitCommand() on
+   * this thread writes into the free end of the arena. A path that does
+   * not fit is dropped and arenaEndPath() returns -1; reset the arena
+   * and generate it again.
+   *
+   * A function that needs working memory for the length of a call, such
+   * as makeDiagonalPathBatch(), takes it from the top of the free space
+   * with arenaBeginScratch() and gives it back with arenaEndScratch().
+   */
+
+  typedef struct {
+    COMMAND *commands;   // terminated with CMD_STOP
+    int length;          // commands before the CMD_STOP
+  } pathResult_t;
+
+  typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t peak;         // most ever used between resets
+    size_t reserved;     // room given to the path being generated
+    int paths;           // paths held since the last reset
+  } arena_t;
+
+  void arenaInit(arena_t *arena, void *memory, size_t size);
+  void arenaReset(arena_t *arena);
+  void *arenaAlloc(arena_t *arena, size_t size);
+  void *arenaBeginScratch(arena_t *arena, size_t size, size_t *mark);
+  void arenaEndScratch(arena_t *arena, size_t mark);
+  int arenaBeginPath(arena_t *arena);
+  int arenaEndPath(arena_t *arena, pathResult_t *path);
+  int arenaStorePath(arena_t *arena, const COMMAND *list, pathResult_t *path);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ARENA_H */
+
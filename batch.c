@@ -0,0 +1,355 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "commands.h"
+#include "makepath.h"
+#include "maze.h"
+#include "flood.h"
+#include "histogram.h"
+#include "timemodel.h"
+#include "peephole.h"
+#include "queue.h"
+
+#ifndef CMD_THREADS
+#error "diagonal-batch generates paths on several threads and needs -DCMD_THREADS"
+#endif
+
+/*
+ * Run the whole chain over many mazes as a pipeline of threads.
+ *
+ *   diagonal-batch [options] [maze files]
+ *
+ * options:
+ *   -n count      number of generated mazes (default 10000)
+ *   -s seed       first generated maze
+ *   -t l,s,d,e    threads for the load, solve, diagonalise and estimate
+ *                 stages (default 1,1,1,1), the report stage has one
+ *   -q size       capacity of each queue between stages (default 64)
+ *   -c caps       run the peephole pass for these CAP_ bits
+ *   -o file       write the CSV here rather than to stdout
+ *
+ * Each maze is a job that moves through the stages on lock-free queues.
+ * Jobs come from a fixed pool and go back to it once reported, so the
+ * memory used does not depend on the number of mazes. With more than one
+ * thread in a stage the rows may come out of order; the first column is
+ * the maze number.
+ *
+ * The time each stage spends working, waiting for input (starved) and
+ * waiting for room downstream (blocked) goes to stderr at the end, with
+ * the rate the stage could reach if all of its threads were kept busy.
+ * The stage that is never starved while the others are is the
+ * bottleneck.
+ */
+
+enum {
+  STAGE_LOAD,
+  STAGE_SOLVE,
+  STAGE_DIAGONAL,
+  STAGE_ESTIMATE,
+  STAGE_REPORT,
+  STAGE_COUNT
+};
+
+#define MAX_STAGE_THREADS (64)
+
+static const char *stageNames[STAGE_COUNT] = {"load", "solve", "diagonal", "estimate", "report"};
+
+typedef struct {
+  int index;
+  int status;          // 0 or a short reason for the failure
+  int routeLength;     // cells from the start to the goal
+  int commandCount;
+  float time;          // estimated by the time model
+  maze_t maze;
+  char route[MAX_ROUTE];
+  COMMAND commands[COMMAND_LIST_SIZE];
+} job_t;
+
+typedef struct {
+  long items;
+  uint64_t busyNs;
+  uint64_t starvedNs;
+  uint64_t blockedNs;
+} stageStats_t;
+
+typedef struct {
+  int count;
+  uint32_t seed;
+  char **files;
+  unsigned capabilities;
+  FILE *out;
+  int threads[STAGE_COUNT];
+  queue_t queues[STAGE_COUNT];  // queues[s] feeds stage s, queues[STAGE_LOAD] holds free jobs
+  atomic_long claimed[STAGE_COUNT];
+} batch_t;
+
+typedef struct {
+  batch_t *batch;
+  int stage;
+  pthread_t thread;
+  stageStats_t stats;
+} worker_t;
+
+enum {
+  JOB_OK,
+  JOB_NO_MAZE,
+  JOB_NO_ROUTE
+};
+
+static const char *statusNames[] = {"ok", "no maze", "no route"};
+
+static job_t *takeJob(queue_t *queue, uint64_t *waitNs) {
+  void *item;
+  if (!queuePop(queue, &item)) {
+    uint64_t start = nowNs();
+    while (!queuePop(queue, &item)) {
+      sched_yield();
+    }
+    *waitNs += nowNs() - start;
+  }
+  return item;
+}
+
+static void passJob(queue_t *queue, job_t *job, uint64_t *waitNs) {
+  if (!queuePush(queue, job)) {
+    uint64_t start = nowNs();
+    while (!queuePush(queue, job)) {
+      sched_yield();
+    }
+    *waitNs += nowNs() - start;
+  }
+}
+
+static void runStage(const batch_t *batch, int stage, job_t *job) {
+  static const unsigned noCapabilities = 0;
+  uint16_t dist[MAZE_CELLS];
+  int heading;
+  if (job->status != JOB_OK) {
+    if (stage == STAGE_REPORT) {
+      fprintf(batch->out, "%d,%s,,,\n", job->index, statusNames[job->status]);
+    }
+    return;
+  }
+  switch (stage) {
+    case STAGE_LOAD:
+      if (batch->files) {
+        if (mazeLoadFile(&job->maze, batch->files[job->index]) != 0) {
+          job->status = JOB_NO_MAZE;
+        }
+      } else {
+        mazeGenerate(&job->maze, batch->seed + job->index);
+      }
+      break;
+    case STAGE_SOLVE:
+      floodMaze(&job->maze, dist);
+      job->routeLength = makeRoute(&job->maze, dist, START_CELL, NORTH, job->route, &heading) - 1;
+      if (job->routeLength < 0) {
+        job->status = JOB_NO_ROUTE;
+      }
+      break;
+    case STAGE_DIAGONAL:
+      setCommandBuffer(job->commands, COMMAND_LIST_SIZE);
+      makeDiagonalPath(job->route);
+      setCommandBuffer(NULL, 0);
+      if (batch->capabilities != noCapabilities) {
+        peepholeOptimise(job->commands, batch->capabilities, timeModelCost, &defaultTimeModel);
+      }
+      for (job->commandCount = 0; job->commands[job->commandCount] != CMD_STOP; job->commandCount++) {
+      }
+      break;
+    case STAGE_ESTIMATE:
+      job->time = listCost(timeModelCost, &defaultTimeModel, job->commands, job->commandCount);
+      break;
+    default:
+      fprintf(batch->out, "%d,%s,%d,%d,%.3f\n", job->index, statusNames[job->status], job->routeLength,
+              job->commandCount, job->time);
+      break;
+  }
+}
+
+/*
+ * Every thread claims a ticket before it takes a job so that each stage
+ * handles exactly count jobs and its threads know when to stop.
+ */
+static void *stageThread(void *arg) {
+  worker_t *worker = arg;
+  batch_t *batch = worker->batch;
+  int stage = worker->stage;
+  queue_t *in = &batch->queues[stage];
+  queue_t *out = &batch->queues[(stage + 1) % STAGE_COUNT];
+  for (;;) {
+    long ticket = atomic_fetch_add(&batch->claimed[stage], 1);
+    job_t *job;
+    uint64_t start;
+    if (ticket >= batch->count) {
+      break;
+    }
+    job = takeJob(in, &worker->stats.starvedNs);
+    if (stage == STAGE_LOAD) {
+      job->index = (int) ticket;
+      job->status = JOB_OK;
+    }
+    start = nowNs();
+    runStage(batch, stage, job);
+    worker->stats.busyNs += nowNs() - start;
+    worker->stats.items++;
+    passJob(out, job, &worker->stats.blockedNs);
+  }
+  return NULL;
+}
+
+static int parseThreads(const char *text, int *threads) {
+  int stage;
+  for (stage = 0; stage < STAGE_REPORT; stage++) {
+    char *end;
+    threads[stage] = (int) strtol(text, &end, 10);
+    if (threads[stage] < 1 || threads[stage] > MAX_STAGE_THREADS || (*end != ',' && *end != 0)) {
+      return -1;
+    }
+    if (*end == 0) {
+      break;
+    }
+    text = end + 1;
+  }
+  for (stage++; stage < STAGE_REPORT; stage++) {
+    threads[stage] = threads[stage - 1];
+  }
+  threads[STAGE_REPORT] = 1;
+  return 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: diagonal-batch [-n mazes] [-s seed] [-t load,solve,diagonal,estimate] [-q size] [-c caps] [-o file] [maze files]\n");
+}
+
+int main(int argc, char** argv) {
+  static batch_t batch;
+  static worker_t workers[STAGE_COUNT * MAX_STAGE_THREADS];
+  const char *outName = NULL;
+  job_t *jobs;
+  int queueSize = 64;
+  int jobCount;
+  int workerCount = 0;
+  uint64_t start;
+  double elapsed;
+  int stage;
+  int i;
+  batch.count = 10000;
+  batch.seed = 1;
+  batch.out = stdout;
+  parseThreads("1", batch.threads);
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+      batch.count = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+      batch.seed = strtoul(argv[++i], NULL, 0);
+    } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+      if (parseThreads(argv[++i], batch.threads) != 0) {
+        usage();
+        return EXIT_FAILURE;
+      }
+    } else if (i + 1 < argc && strcmp(argv[i], "-q") == 0) {
+      queueSize = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-c") == 0) {
+      batch.capabilities = strtoul(argv[++i], NULL, 0) & (CAP_ALL | CAP_INTEGRATED);
+    } else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+      outName = argv[++i];
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (i < argc) {
+    batch.files = argv + i;
+    batch.count = argc - i;
+  }
+  if (outName && (batch.out = fopen(outName, "w")) == NULL) {
+    fprintf(stderr, "could not write %s\n", outName);
+    return EXIT_FAILURE;
+  }
+
+  /* every job fits in the free queue so a returned job always has a slot */
+  queueSize = queueInit(&batch.queues[STAGE_SOLVE], queueSize > 0 ? queueSize : 1);
+  for (stage = STAGE_DIAGONAL; stage < STAGE_COUNT; stage++) {
+    queueInit(&batch.queues[stage], queueSize);
+  }
+  jobCount = queueInit(&batch.queues[STAGE_LOAD], 2 * queueSize);
+  jobs = calloc(jobCount, sizeof (job_t));
+  if (jobs == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < jobCount; i++) {
+    queuePush(&batch.queues[STAGE_LOAD], &jobs[i]);
+  }
+
+  fprintf(batch.out, "maze,status,route_cells,commands,time_s\n");
+  start = nowNs();
+  for (stage = 0; stage < STAGE_COUNT; stage++) {
+    atomic_init(&batch.claimed[stage], 0);
+    for (i = 0; i < batch.threads[stage]; i++) {
+      worker_t *worker = &workers[workerCount++];
+      worker->batch = &batch;
+      worker->stage = stage;
+      if (pthread_create(&worker->thread, NULL, stageThread, worker) != 0) {
+        fprintf(stderr, "could not start a thread\n");
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  for (i = 0; i < workerCount; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  elapsed = (nowNs() - start) * 1e-9;
+
+  fprintf(stderr, "%d mazes in %.3f s, %.0f mazes/s, %d jobs in flight at most\n", batch.count, elapsed,
+          batch.count / elapsed, jobCount);
+  fprintf(stderr, "%-10s %7s %9s %9s %12s %10s %10s\n", "stage", "threads", "items", "busy s", "items/s", "starved s", "blocked s");
+  for (stage = 0; stage < STAGE_COUNT; stage++) {
+    stageStats_t total = {0, 0, 0, 0};
+    for (i = 0; i < workerCount; i++) {
+      if (workers[i].stage == stage) {
+        total.items += workers[i].stats.items;
+        total.busyNs += workers[i].stats.busyNs;
+        total.starvedNs += workers[i].stats.starvedNs;
+        total.blockedNs += workers[i].stats.blockedNs;
+      }
+    }
+    fprintf(stderr, "%-10s %7d %9ld %9.3f %12.0f %10.3f %10.3f\n", stageNames[stage], batch.threads[stage], total.items,
+            total.busyNs * 1e-9, total.busyNs ? total.items / (total.busyNs * 1e-9) * batch.threads[stage] : 0.0,
+            total.starvedNs * 1e-9, total.blockedNs * 1e-9);
+  }
+  if (outName) {
+    fclose(batch.out);
+  }
+  free(jobs);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,935 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "commands.h"
+#include "makepath.h"
+#include "maze.h"
+#include "flood.h"
+#include "planner.h"
+#include "histogram.h"
+#include "explore.h"
+#include "codec.h"
+#include "testdata.h"
+#include "drive.h"
+#include "timemodel.h"
+#include "peephole.h"
+#include "stride.h"
+#include "route.h"
+#include "arena.h"
+#include "generator.h"
+#include "cmdqueue.h"
+#include "strategy.h"
+
+/*
+ * Benchmarks for the path generator and the planners that feed it.
+ *
+ *   diagonal-bench replan  [options] [maze files]
+ *   diagonal-bench explore [options] [maze files]
+ *   diagonal-bench codec   [options] [maze files]
+ *   diagonal-bench drive   [options] [maze files]
+ *   diagonal-bench stride  [options]
+ *   diagonal-bench arena   [options]
+ *   diagonal-bench generators [options] [maze files]
+ *   diagonal-bench cmdqueue [options]
+ *   diagonal-bench strategy [options] [maze files]
+ *   diagonal-bench trie   [options] [maze files]
+ *
+ * options:
+ *   -n count   number of generated mazes (default 1000)
+ *   -s seed    first generated maze
+ *   -b budget  planner expansions per call
+ *   -d usecs   per cell planning deadline
+ *   -f         plan with a full flood rather than the incremental planner
+ *   -p depth   speculate this many cells ahead on a second thread
+ *   -m kbytes  memory cap for speculation (default 256)
+ *   -w usecs   longest wait for the speculation before planning (default 1000)
+ *   -t bits    keep a transposition table of 2^bits entries across mazes
+ *   --generator=name   compare this generator with the reference
+ *   --compare=a,b      compare these two generators
+ *   -v         report every maze
+ *
+ * Maze files are used if they are given, otherwise a set of generated
+ * mazes is used so that runs are repeatable.
+ */
+
+typedef struct {
+  int mazeCount;
+  uint32_t seed;
+  int verbose;
+  int fileCount;
+  char **files;
+  exploreConfig_t explore;
+  int tableBits;
+  const generator_t *compare[2];
+} benchOptions_t;
+
+static int parseOptions(int argc, char **argv, benchOptions_t *options) {
+  int i;
+  memset(options, 0, sizeof (*options));
+  options->mazeCount = 1000;
+  options->seed = 1;
+  options->explore.incremental = 1;
+  options->explore.speculateMemory = 256 * 1024;
+  options->explore.driveNs = 1000000;
+  for (i = 0; i < argc && argv[i][0] == '-'; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+      options->mazeCount = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+      options->seed = strtoul(argv[++i], NULL, 0);
+    } else if (i + 1 < argc && strcmp(argv[i], "-b") == 0) {
+      options->explore.budget = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+      options->explore.deadlineNs = (uint64_t) (atof(argv[++i]) * 1000.0);
+    } else if (i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+      options->explore.speculateDepth = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+      options->explore.speculateMemory = (size_t) atoi(argv[++i]) * 1024;
+    } else if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+      options->explore.driveNs = (uint64_t) (atof(argv[++i]) * 1000.0);
+    } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+      options->tableBits = atoi(argv[++i]);
+    } else if (strncmp(argv[i], "--generator=", 12) == 0 && findGenerator(argv[i] + 12) != NULL) {
+      options->compare[0] = generatorAt(0);
+      options->compare[1] = findGenerator(argv[i] + 12);
+    } else if (strncmp(argv[i], "--compare=", 10) == 0 && strchr(argv[i], ',') != NULL) {
+      char names[64];
+      char *second;
+      snprintf(names, sizeof (names), "%s", argv[i] + 10);
+      second = strchr(names, ',');
+      *second++ = 0;
+      options->compare[0] = findGenerator(names);
+      options->compare[1] = findGenerator(second);
+      if (options->compare[0] == NULL || options->compare[1] == NULL) {
+        fprintf(stderr, "unknown generator in %s\n", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(argv[i], "-f") == 0) {
+      options->explore.incremental = 0;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      options->verbose = 1;
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return -1;
+    }
+  }
+  if (i < argc) {
+    options->fileCount = argc - i;
+    options->files = argv + i;
+    options->mazeCount = options->fileCount;
+  }
+  return 0;
+}
+
+static int loadMaze(maze_t *maze, int index, const benchOptions_t *options) {
+  if (options->fileCount > 0) {
+    if (mazeLoadFile(maze, options->files[index]) != 0) {
+      fprintf(stderr, "could not read maze %s\n", options->files[index]);
+      return -1;
+    }
+  } else {
+    mazeGenerate(maze, options->seed + index);
+  }
+  return 0;
+}
+
+static void printLatency(const char *name, const histogram_t *hist) {
+  printf("%-10s %9u %10.0f %10llu %10llu %10llu\n", name, hist->n,
+         hist->n ? (double) hist->total / hist->n : 0.0,
+         (unsigned long long) histPercentile(hist, 50.0),
+         (unsigned long long) histPercentile(hist, 99.0),
+         (unsigned long long) hist->max);
+}
+
+/*
+ * Explore every maze with the re-flood and with the incremental planner
+ * and compare the work and time taken to plan each cell.
+ */
+static int benchReplan(const benchOptions_t *options) {
+  static maze_t maze;
+  static exploreResult_t results[2];
+  exploreConfig_t config = options->explore;
+  int m;
+  int i;
+  exploreResultClear(&results[0]);
+  exploreResultClear(&results[1]);
+  for (m = 0; m < options->mazeCount; m++) {
+    if (loadMaze(&maze, m, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    for (i = 0; i < 2; i++) {
+      config.incremental = i;
+      exploreMaze(&maze, &config, &results[i]);
+    }
+  }
+  printf("%d mazes explored\n", options->mazeCount);
+  printf("%-12s %8s %12s %12s %10s %10s %10s\n", "planner", "steps", "cells/step", "worst cells", "mean ns", "p99 ns", "worst ns");
+  for (i = 0; i < 2; i++) {
+    exploreResult_t *r = &results[i];
+    printf("%-12s %8d %12.1f %12d %10.0f %10llu %10llu\n", i ? "incremental" : "re-flood", r->steps,
+           (double) r->expansions / r->steps, r->maxExpansions,
+           (double) r->solve.total / r->solve.n,
+           (unsigned long long) histPercentile(&r->solve, 99.0),
+           (unsigned long long) r->solve.max);
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Run the search simulator over every maze and report the latency of
+ * each planning step, how much of each maze was searched and whether the
+ * per cell deadline was ever missed.
+ */
+static int benchExplore(const benchOptions_t *options) {
+  static maze_t maze;
+  static exploreResult_t total;
+  static exploreResult_t result;
+  static transTable_t table;
+  exploreConfig_t config = options->explore;
+  uint64_t start;
+  int failed = 0;
+  int m;
+  if (options->tableBits > 0) {
+    if (transInit(&table, options->tableBits) != 0) {
+      fprintf(stderr, "could not allocate a table of 2^%d entries\n", options->tableBits);
+      return EXIT_FAILURE;
+    }
+    config.table = &table;
+  }
+  start = nowNs();
+  exploreResultClear(&total);
+  for (m = 0; m < options->mazeCount; m++) {
+    if (loadMaze(&maze, m, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    exploreResultClear(&result);
+    if (exploreMaze(&maze, &config, &result) != 0) {
+      failed++;
+    }
+    if (options->verbose || options->mazeCount == 1) {
+      makeDiagonalPath(result.route);
+      printf("maze %5d: %4d steps %4d cells  worst %6llu ns  %s\n  => ", m, result.steps, result.cellsVisited,
+             (unsigned long long) result.step.max, result.route);
+      listCommands();
+    }
+    histMerge(&total.solve, &result.solve);
+    histMerge(&total.generate, &result.generate);
+    histMerge(&total.step, &result.step);
+    total.steps += result.steps;
+    total.cellsVisited += result.cellsVisited;
+    total.deadlineMisses += result.deadlineMisses;
+    total.speculateHits += result.speculateHits;
+    total.speculateMisses += result.speculateMisses;
+    total.speculateLate += result.speculateLate;
+    total.speculateBuilt += result.speculateBuilt;
+    total.speculateReused += result.speculateReused;
+    total.tableHits += result.tableHits;
+    total.tableMisses += result.tableMisses;
+    total.tableHitNs += result.tableHitNs;
+    total.tableMissNs += result.tableMissNs;
+  }
+  printf("%d mazes explored with the %s in %.2f s, %d did not reach the goal\n", options->mazeCount,
+         options->explore.incremental ? "incremental planner" : "full flood", (nowNs() - start) * 1e-9, failed);
+  printf("%.1f steps and %.1f cells visited per maze\n", (double) total.steps / options->mazeCount,
+         (double) total.cellsVisited / options->mazeCount);
+  printf("%-10s %9s %10s %10s %10s %10s\n", "ns", "count", "mean", "p50", "p99", "max");
+  printLatency("solve", &total.solve);
+  printLatency("generate", &total.generate);
+  printLatency("step", &total.step);
+  if (options->explore.speculateDepth) {
+    printf("speculating %d cells ahead in %zu KB with %.0f us to drive a cell: %d hits, %d misses (%.1f%%) of which %d late\n",
+           options->explore.speculateDepth, options->explore.speculateMemory / 1024, options->explore.driveNs * 1e-3,
+           total.speculateHits, total.speculateMisses,
+           100.0 * total.speculateMisses / (total.speculateHits + total.speculateMisses), total.speculateLate);
+    printf("%.1f outcomes planned and %.1f reused per step\n", (double) total.speculateBuilt / total.steps,
+           (double) total.speculateReused / total.steps);
+  }
+  if (config.table != NULL && total.tableMisses > 0) {
+    double hitNs = total.tableHits ? (double) total.tableHitNs / total.tableHits : 0.0;
+    double missNs = (double) total.tableMissNs / total.tableMisses;
+    printf("table of %lu entries in %zu KB: %d hits, %d misses (%.1f%%), %.0f ns per hit against %.0f ns per miss\n",
+           (unsigned long) (table.mask + 1), (size_t) (table.mask + 1) * sizeof (transEntry_t) / 1024, total.tableHits,
+           total.tableMisses, 100.0 * total.tableHits / (total.tableHits + total.tableMisses), hitNs, missNs);
+    printf("about %.1f ms of planning saved, %.1f%% of the step time\n", total.tableHits * (missNs - hitNs) * 1e-6,
+           100.0 * total.tableHits * (missNs - hitNs) / (total.step.total + total.tableHits * (missNs - hitNs)));
+    transFree(&table);
+  }
+  if (options->explore.deadlineNs) {
+    printf("%d steps missed the %.1f us deadline\n", total.deadlineMisses, options->explore.deadlineNs / 1000.0);
+  }
+  return (failed || total.deadlineMisses) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Encode the command lists for the test routes, a set of random routes
+ * and the routes found by exploring each maze and report how many bytes
+ * they take on the telemetry link compared with one byte per command,
+ * both with and without the frame headers.
+ */
+typedef struct {
+  int lists;
+  long commands;
+  long frames;
+  long bytes;
+} codecCount_t;
+
+static void codecCount(codecCount_t *count, const char *route) {
+  static uint8_t stream[2048];
+  int n;
+  makeDiagonalPath(route);
+  for (n = 0; commandList[n] != CMD_STOP; n++) {
+  }
+  count->lists++;
+  count->commands += n + 1;
+  count->frames += n / CODEC_FRAME_COMMANDS + 1;
+  count->bytes += encodeList(commandList, stream, sizeof (stream), CODEC_FRAME_COMMANDS);
+}
+
+static void codecReport(const char *name, codecCount_t *count) {
+  printf("%-10s %7d %10ld %10ld %8.2f %8.2f %10.2f\n", name, count->lists, count->commands, count->bytes,
+         (double) count->bytes / count->commands,
+         (double) (count->bytes - CODEC_FRAME_OVERHEAD * count->frames) / count->commands,
+         (double) count->bytes / count->lists);
+  memset(count, 0, sizeof (*count));
+}
+
+static int benchCodec(const benchOptions_t *options) {
+  static maze_t maze;
+  static exploreResult_t result;
+  codecCount_t count;
+  char route[MAX_ROUTE];
+  uint32_t seed = options->seed;
+  int i;
+  memset(&count, 0, sizeof (count));
+  printf("%-10s %7s %10s %10s %8s %8s %10s\n", "routes", "lists", "commands", "bytes", "ratio", "payload", "bytes/list");
+  for (i = 0; i < testCountDiagonal(); i++) {
+    codecCount(&count, testPairsDiagonal[i].input);
+  }
+  codecReport("test", &count);
+  for (i = 0; i < options->mazeCount; i++) {
+    makeRandomRoute(route, sizeof (route), &seed);
+    codecCount(&count, route);
+  }
+  codecReport("random", &count);
+  for (i = 0; i < options->mazeCount; i++) {
+    if (loadMaze(&maze, i, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    exploreResultClear(&result);
+    exploreMaze(&maze, &options->explore, &result);
+    codecCount(&count, result.route);
+  }
+  codecReport("explored", &count);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Drive the path for the shortest route through every maze, as generated
+ * and after the peephole pass for each set of capabilities, and report
+ * how fast lists can be validated and how many fail.
+ */
+static int benchDrive(const benchOptions_t *options) {
+  static const unsigned capabilities[] = {CAP_ALL | CAP_INTEGRATED, CAP_ALL, CAP_ALL & ~CAP_DIAGONAL, CAP_IN_PLACE | CAP_SMOOTH_90, CAP_IN_PLACE};
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  static COMMAND path[COMMAND_LIST_SIZE];
+  driveResult_t result;
+  char route[MAX_ROUTE];
+  long samples = 0;
+  long paths = 0;
+  int failures[4] = {0, 0, 0, 0};
+  uint64_t elapsed = 0;
+  int m;
+  int c;
+  for (m = 0; m < options->mazeCount; m++) {
+    int heading;
+    if (loadMaze(&maze, m, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    floodMaze(&maze, dist);
+    if (makeRoute(&maze, dist, START_CELL, NORTH, route, &heading) < 0) {
+      continue;
+    }
+    makeDiagonalPath(route);
+    memcpy(path, commandList, sizeof (path));
+    for (c = 0; c <= (int) (sizeof (capabilities) / sizeof (capabilities[0])); c++) {
+      uint64_t start;
+      memcpy(commandList, path, sizeof (path));
+      if (c > 0) {
+        peepholeOptimise(commandList, capabilities[c - 1], timeModelCost, &defaultTimeModel);
+      }
+      start = nowNs();
+      driveList(&maze, commandList, &defaultMouseModel, NULL, 0, &result);
+      elapsed += nowNs() - start;
+      failures[result.status]++;
+      samples += result.samples;
+      paths++;
+      if (options->verbose && result.status != DRIVE_OK) {
+        printf("maze %5d: status %d at command %d (%.0f, %.0f)  %s\n  => ", m, result.status, result.command,
+               result.x, result.y, route);
+        listCommands();
+      }
+    }
+  }
+  printf("%ld paths driven in %.3f s, %.0f paths/s, %.1f ns per sample\n", paths, elapsed * 1e-9,
+         paths / (elapsed * 1e-9), (double) elapsed / samples);
+  printf("%d ok, %d bad command, %d no room for a turn, %d collisions\n", failures[DRIVE_OK],
+         failures[DRIVE_BAD_COMMAND], failures[DRIVE_NO_ROOM], failures[DRIVE_COLLISION]);
+  return failures[DRIVE_OK] == paths ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Time the single step generator against the stride generator and the
+ * packed route generator over a pool of random routes, -n times over,
+ * and show what the table and the routes cost in memory. The single step
+ * generator is also timed with a source map to show what that costs.
+ */
+#define STRIDE_POOL 256
+
+static int benchStride(const benchOptions_t *options) {
+  static char pool[STRIDE_POOL][MAX_ROUTE];
+  static packedRoute_t packed[STRIDE_POOL];
+  static sourceSpan_t map[COMMAND_LIST_SIZE];
+  uint32_t seed = options->seed;
+  uint64_t elapsed[4] = {0, 0, 0, 0};
+  long chars = 0;
+  int pass;
+  int i;
+  int g;
+  if (strideInit() != 0 || strideVerify() != 0) {
+    fprintf(stderr, "stride table does not match the generator\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < STRIDE_POOL; i++) {
+    chars += makeRandomRoute(pool[i], MAX_ROUTE, &seed);
+    routePack(&packed[i], pool[i]);
+  }
+  for (pass = 0; pass < options->mazeCount; pass++) {
+    for (g = 0; g < 4; g++) {
+      uint64_t start = nowNs();
+      for (i = 0; i < STRIDE_POOL; i++) {
+        if (g == 3) {
+          makeDiagonalPathMapped(pool[i], START_CELL, NORTH, map, COMMAND_LIST_SIZE);
+        } else if (g == 2) {
+          makeDiagonalPathPacked(&packed[i]);
+        } else if (g == 1) {
+          makeDiagonalPathStride(pool[i]);
+        } else {
+          makeDiagonalPath(pool[i]);
+        }
+      }
+      elapsed[g] += nowNs() - start;
+    }
+  }
+  chars *= options->mazeCount;
+  printf("%ld characters in %d routes\n", chars, STRIDE_POOL * options->mazeCount);
+  printf("%-12s %8s %10s %10s %10s\n", "generator", "ns/char", "Mchar/s", "table", "route");
+  printf("%-12s %8.2f %10.1f %10s %8d B\n", "single step", (double) elapsed[0] / chars, chars * 1e3 / elapsed[0], "-", MAX_ROUTE);
+  printf("stride %-5d %8.2f %10.1f %8d B %8d B\n", PATH_STRIDE, (double) elapsed[1] / chars, chars * 1e3 / elapsed[1],
+         strideTableSize(), MAX_ROUTE);
+  printf("%-12s %8.2f %10.1f %10s %8d B\n", "packed", (double) elapsed[2] / chars, chars * 1e3 / elapsed[2], "-",
+         (int) sizeof (packedRoute_t));
+  printf("%-12s %8.2f %10.1f %10s %8d B\n", "source map", (double) elapsed[3] / chars, chars * 1e3 / elapsed[3], "-", MAX_ROUTE);
+  printf("speedup %.2f, %d entries of %d bytes\n", (double) elapsed[0] / elapsed[1], STRIDE_STATES * STRIDE_CODES,
+         (int) sizeof (strideEntry_t));
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Keep a batch of -n x ARENA_SCALE paths in memory, once as fixed
+ * command lists copied out of commandList and once generated straight
+ * into an arena, then read every path back. The routes are the shortest
+ * routes through a pool of generated mazes. Each batch is generated and
+ * read ARENA_BATCHES times and the memory is only allocated once.
+ */
+#define ARENA_SCALE    16
+#define ARENA_BATCHES  20
+#define ARENA_ROOM     64
+
+static long arenaScan(const COMMAND *list) {
+  long sum = 0;
+  while (*list != CMD_STOP) {
+    sum += *list++;
+  }
+  return sum;
+}
+
+static int benchArena(const benchOptions_t *options) {
+  static char pool[STRIDE_POOL][MAX_ROUTE];
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  int count = options->mazeCount * ARENA_SCALE;
+  size_t size = (size_t) count * ARENA_ROOM + COMMAND_LIST_SIZE;
+  COMMAND (*fixed)[COMMAND_LIST_SIZE] = malloc((size_t) count * sizeof (*fixed));
+  pathResult_t *paths = malloc((size_t) count * sizeof (*paths));
+  void *memory = malloc(size);
+  arena_t arena;
+  uint64_t elapsed[2][2] = {{0, 0}, {0, 0}};
+  long sums[2] = {0, 0};
+  int dropped = 0;
+  int batch;
+  int i;
+  if (fixed == NULL || paths == NULL || memory == NULL) {
+    fprintf(stderr, "not enough memory for %d paths\n", count);
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < STRIDE_POOL; i++) {
+    int heading;
+    mazeGenerate(&maze, options->seed + i);
+    floodMaze(&maze, dist);
+    if (makeRoute(&maze, dist, START_CELL, NORTH, pool[i], &heading) < 0) {
+      strcpy(pool[i], "FS");
+    }
+  }
+  arenaInit(&arena, memory, size);
+  for (batch = 0; batch < ARENA_BATCHES; batch++) {
+    uint64_t start = nowNs();
+    for (i = 0; i < count; i++) {
+      makeDiagonalPath(pool[i % STRIDE_POOL]);
+      memcpy(fixed[i], commandList, sizeof (fixed[i]));
+    }
+    elapsed[0][0] += nowNs() - start;
+    start = nowNs();
+    for (i = 0; i < count; i++) {
+      sums[0] += arenaScan(fixed[i]);
+    }
+    elapsed[0][1] += nowNs() - start;
+    start = nowNs();
+    arenaReset(&arena);
+    for (i = 0; i < count; i++) {
+      arenaBeginPath(&arena);
+      makeDiagonalPath(pool[i % STRIDE_POOL]);
+      if (arenaEndPath(&arena, &paths[i]) != 0) {
+        paths[i].commands = commandList;
+        dropped++;
+      }
+    }
+    elapsed[1][0] += nowNs() - start;
+    start = nowNs();
+    for (i = 0; i < count; i++) {
+      sums[1] += arenaScan(paths[i].commands);
+    }
+    elapsed[1][1] += nowNs() - start;
+  }
+  count *= ARENA_BATCHES;
+  printf("%d paths in batches of %d\n", count, count / ARENA_BATCHES);
+  printf("%-8s %12s %10s %12s %12s\n", "storage", "batch", "B/path", "generate ns", "read ns");
+  printf("%-8s %10.2f M %10d %12.1f %12.1f\n", "fixed", (double) count / ARENA_BATCHES * COMMAND_LIST_SIZE / 1e6,
+         COMMAND_LIST_SIZE, (double) elapsed[0][0] / count, (double) elapsed[0][1] / count);
+  printf("%-8s %10.2f M %10.1f %12.1f %12.1f\n", "arena", arena.peak / 1e6, (double) arena.peak * ARENA_BATCHES / count,
+         (double) elapsed[1][0] / count, (double) elapsed[1][1] / count);
+  free(fixed);
+  free(paths);
+  free(memory);
+  if (dropped != 0 || sums[0] != sums[1]) {
+    fprintf(stderr, "%d paths did not fit, the arena read back %s\n", dropped, sums[0] == sums[1] ? "the same" : "differently");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Compare generators side by side over the shortest routes through the
+ * mazes and the same number of random routes: the reference against every
+ * other generator, or just the pair asked for. Each corpus is generated
+ * ten times over for the timing.
+ */
+static int benchGenerators(const benchOptions_t *options) {
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  int count = 2 * options->mazeCount;
+  char (*store)[MAX_ROUTE] = malloc((size_t) count * sizeof (*store));
+  const char **routes = malloc((size_t) count * sizeof (*routes));
+  uint32_t seed = options->seed;
+  int failed = 0;
+  int n = 0;
+  int m;
+  int g;
+  if (store == NULL || routes == NULL) {
+    fprintf(stderr, "not enough memory for %d routes\n", count);
+    return EXIT_FAILURE;
+  }
+  for (m = 0; m < options->mazeCount; m++) {
+    int heading;
+    if (loadMaze(&maze, m, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    floodMaze(&maze, dist);
+    if (makeRoute(&maze, dist, START_CELL, NORTH, store[n], &heading) >= 0) {
+      routes[n] = store[n];
+      n++;
+    }
+    makeRandomRoute(store[n], MAX_ROUTE, &seed);
+    routes[n] = store[n];
+    n++;
+  }
+  printf("%-10s %-10s %8s %8s %10s %10s %8s\n", "reference", "generator", "routes", "skipped", "differ", "ns/char", "speed");
+  for (g = 1; g < generatorCount(); g++) {
+    const generator_t *a = options->compare[0] ? options->compare[0] : generatorAt(0);
+    const generator_t *b = options->compare[1] ? options->compare[1] : generatorAt(g);
+    generatorComparison_t result;
+    if (compareGenerators(a, b, routes, n, 10, &result) != 0) {
+      failed++;
+      if (result.firstMismatch < 0) {
+        fprintf(stderr, "could not initialise %s or %s\n", a->name, b->name);
+        continue;
+      }
+    }
+    printf("%-10s %-10s %8ld %8ld %10ld %10.2f %7.2fx\n", a->name, b->name, result.routes, result.skipped, result.mismatches,
+           result.elapsed[1] / (10.0 * result.characters), (double) result.elapsed[0] / result.elapsed[1]);
+    if (options->verbose && result.firstMismatch >= 0) {
+      printf("  first difference: %s\n", routes[result.firstMismatch]);
+    }
+    if (options->compare[0]) {
+      break;
+    }
+  }
+  free(store);
+  free(routes);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Stress the command queue: the planner thread generates -n x 100
+ * random paths straight into the queue while an executor thread pops
+ * them, and every command's time from emitCommand() to being popped is
+ * recorded. The emit times travel in a ring beside the queue, indexed
+ * the same way. The executor releases a time with a count of the times
+ * it has read, after the command is popped, and the sink only writes a
+ * slot once the time before in it has been read, so a time taken while
+ * the queue is full waits for its slot rather than overwriting another.
+ */
+#define CMDQ_BENCH_SCALE 100
+
+typedef struct {
+  commandQueue_t queue;
+  uint64_t emitted[CMDQ_SIZE];
+  _Alignas(64) atomic_uint consumed;   // times read by the executor
+  unsigned sequence;
+  long total;
+  histogram_t latency;
+} cmdqBench_t;
+
+static void cmdqBenchSink(void *context, COMMAND cmd) {
+  cmdqBench_t *bench = context;
+  uint64_t now = nowNs();
+  while (bench->sequence - atomic_load_explicit(&bench->consumed, memory_order_acquire) >= CMDQ_SIZE) {
+    sched_yield();
+  }
+  bench->emitted[bench->sequence++ & (CMDQ_SIZE - 1)] = now;
+  commandQueueSink(&bench->queue, cmd);
+}
+
+static void *cmdqExecutor(void *arg) {
+  cmdqBench_t *bench = arg;
+  unsigned sequence = 0;
+  long n = 0;
+  while (n < bench->total) {
+    COMMAND cmd;
+    uint64_t emitted;
+    if (!commandQueuePop(&bench->queue, &cmd)) {
+      sched_yield();
+      continue;
+    }
+    emitted = bench->emitted[sequence++ & (CMDQ_SIZE - 1)];
+    atomic_store_explicit(&bench->consumed, sequence, memory_order_release);
+    histRecord(&bench->latency, nowNs() - emitted);
+    n++;
+  }
+  return NULL;
+}
+
+static int benchCommandQueue(const benchOptions_t *options) {
+  static char pool[STRIDE_POOL][MAX_ROUTE];
+  static cmdqBench_t bench;
+  long paths = (long) options->mazeCount * CMDQ_BENCH_SCALE;
+  uint32_t seed = options->seed;
+  pthread_t executor;
+  uint64_t start;
+  uint64_t elapsed;
+  long p;
+  int i;
+  bench.total = 0;
+  for (i = 0; i < STRIDE_POOL; i++) {
+    makeRandomRoute(pool[i], 64, &seed);
+    makeDiagonalPath(pool[i]);
+  }
+  for (p = 0; p < paths; p++) {
+    makeDiagonalPath(pool[p % STRIDE_POOL]);
+    bench.total += commandCount();
+  }
+  commandQueueInit(&bench.queue);
+  histClear(&bench.latency);
+  atomic_init(&bench.consumed, 0);
+  bench.sequence = 0;
+  if (pthread_create(&executor, NULL, cmdqExecutor, &bench) != 0) {
+    fprintf(stderr, "could not start the executor thread\n");
+    return EXIT_FAILURE;
+  }
+  start = nowNs();
+  setCommandSink(cmdqBenchSink, &bench);
+  for (p = 0; p < paths; p++) {
+    makeDiagonalPath(pool[p % STRIDE_POOL]);
+  }
+  setCommandSink(NULL, NULL);
+  pthread_join(executor, NULL);
+  elapsed = nowNs() - start;
+  printf("%ld paths, %ld commands through a %d slot queue in %.3f s, %.1f M commands/s\n", paths, bench.total,
+         CMDQ_SIZE, elapsed * 1e-9, bench.total * 1e3 / elapsed);
+  printf("%-10s %9s %10s %10s %10s %10s\n", "ns", "count", "mean", "p50", "p99", "max");
+  printLatency("latency", &bench.latency);
+  return bench.latency.n == (uint32_t) bench.total ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Pick the fastest strategy for the shortest route in each maze, once
+ * with the default time model and once with a mouse that is half as
+ * fast on diagonals, and compare the cost of a pick with generating the
+ * diagonal path alone.
+ */
+static int benchStrategy(const benchOptions_t *options) {
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  timeModel_t models[2];
+  char route[MAX_ROUTE];
+  int k;
+  models[0] = defaultTimeModel;
+  models[1] = defaultTimeModel;
+  models[1].diagonalBase *= 2.0f;
+  models[1].diagonalPerCell *= 2.0f;
+  models[1].diagonalPerRootCell *= 2.0f;
+  for (k = 0; k < 2; k++) {
+    int picks[STRATEGY_COUNT] = {0, 0, 0};
+    double bestTotal = 0.0;
+    double diagonalTotal = 0.0;
+    uint64_t pickNs = 0;
+    uint64_t diagonalNs = 0;
+    long paths = 0;
+    int m;
+    int r;
+    for (m = 0; m < options->mazeCount; m++) {
+      int heading;
+      float best = 0.0f;
+      int chosen = 0;
+      uint64_t start;
+      if (loadMaze(&maze, m, options) != 0) {
+        return EXIT_FAILURE;
+      }
+      floodMaze(&maze, dist);
+      if (makeRoute(&maze, dist, START_CELL, NORTH, route, &heading) < 0) {
+        continue;
+      }
+      start = nowNs();
+      for (r = 0; r < 10; r++) {
+        chosen = makeBestPath(route, CAP_ALL, timeModelCost, &models[k], &best);
+      }
+      pickNs += nowNs() - start;
+      start = nowNs();
+      for (r = 0; r < 10; r++) {
+        makeDiagonalPath(route);
+      }
+      diagonalNs += nowNs() - start;
+      picks[chosen]++;
+      bestTotal += best;
+      diagonalTotal += listCost(timeModelCost, &models[k], commandList, commandCount());
+      paths++;
+      if (options->verbose) {
+        printf("maze %5d: %-8s %.3f s  %s\n", m, strategyNames[chosen], best, route);
+      }
+    }
+    if (paths == 0) {
+      continue;
+    }
+    printf("%s diagonals: %d in-place, %d smooth, %d diagonal picks from %ld mazes\n", k ? "slow" : "default",
+           picks[STRATEGY_IN_PLACE], picks[STRATEGY_SMOOTH], picks[STRATEGY_DIAGONAL], paths);
+    printf("  mean time %.3f s against %.3f s diagonal only (%.1f%% faster)\n", bestTotal / paths,
+           diagonalTotal / paths, 100.0 * (diagonalTotal - bestTotal) / diagonalTotal);
+    printf("  %.0f ns per pick, %.0f ns per diagonal path\n", pickNs / (10.0 * paths), diagonalNs / (10.0 * paths));
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Generate the candidate routes a planner weighs when it looks ahead:
+ * for each maze the shortest route and the route for each wall on it
+ * turning out to be present. They share long prefixes. Each maze's set
+ * is generated one call per route, as a batch that sorts the set and as
+ * a batch given it already sorted, 10 times over.
+ */
+#define TRIE_REPEATS 10
+
+static int compareRoutes(const void *a, const void *b) {
+  return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+static int benchTrie(const benchOptions_t *options) {
+  static maze_t maze;
+  static maze_t blocked;
+  static uint16_t dist[MAZE_CELLS];
+  static pathResult_t results[MAX_ROUTE + 1];
+  static uint8_t memory[(MAX_ROUTE + 1) * COMMAND_LIST_SIZE];
+  int capacity = options->mazeCount * (MAX_ROUTE / 4);
+  char (*store)[MAX_ROUTE] = malloc((size_t) capacity * sizeof (*store));
+  const char **routes = malloc((size_t) capacity * sizeof (*routes));
+  const char **sorted = malloc((size_t) capacity * sizeof (*sorted));
+  int *sets = malloc((size_t) (options->mazeCount + 1) * sizeof (*sets));
+  uint64_t elapsed[3] = {0, 0, 0};
+  arena_t arena;
+  long chars = 0;
+  long shared = 0;
+  int failed = 0;
+  int count = 0;
+  int setCount = 0;
+  int pass;
+  int m;
+  int g;
+  int i;
+  if (store == NULL || routes == NULL || sorted == NULL || sets == NULL) {
+    fprintf(stderr, "not enough memory for %d routes\n", capacity);
+    return EXIT_FAILURE;
+  }
+  for (m = 0; m < options->mazeCount; m++) {
+    const char *s;
+    int cell = START_CELL;
+    int heading = NORTH;
+    int base = count;
+    if (loadMaze(&maze, m, options) != 0) {
+      return EXIT_FAILURE;
+    }
+    floodMaze(&maze, dist);
+    if (makeRoute(&maze, dist, START_CELL, NORTH, store[count], NULL) < 0) {
+      continue;
+    }
+    sets[setCount++] = count++;
+    for (s = store[base]; *s != 'S' && count < capacity; s++) {
+      heading = (heading + (*s == 'R') + 3 * (*s == 'L')) & 3;
+      blocked = maze;
+      mazeSetWall(&blocked, cell, heading, 1);
+      floodMaze(&blocked, dist);
+      if (makeRoute(&blocked, dist, START_CELL, NORTH, store[count], NULL) >= 0) {
+        count++;
+      }
+      cell = mazeNeighbour(cell, heading);
+    }
+  }
+  sets[setCount] = count;
+  for (i = 0; i < count; i++) {
+    routes[i] = sorted[i] = store[i];
+    chars += (long) strlen(store[i]) + 1;
+  }
+  for (m = 0; m < setCount; m++) {
+    qsort(sorted + sets[m], (size_t) (sets[m + 1] - sets[m]), sizeof (*sorted), compareRoutes);
+    for (i = sets[m] + 1; i < sets[m + 1]; i++) {
+      const char *a = sorted[i - 1];
+      const char *b = sorted[i];
+      while (*a != 0 && *a == *b) {
+        a++;
+        b++;
+        shared++;
+      }
+    }
+  }
+  arenaInit(&arena, memory, sizeof (memory));
+  for (pass = 0; pass < TRIE_REPEATS; pass++) {
+    for (g = 0; g < 3; g++) {
+      uint64_t start = nowNs();
+      for (m = 0; m < setCount; m++) {
+        int n = sets[m + 1] - sets[m];
+        arenaReset(&arena);
+        if (g == 0) {
+          for (i = 0; i < n; i++) {
+            makeDiagonalPath(routes[sets[m] + i]);
+            failed += arenaStorePath(&arena, commandList, &results[i]) != 0;
+          }
+        } else {
+          failed += makeDiagonalPathBatch((g == 2 ? sorted : routes) + sets[m], n, g == 2, &arena, results) != 0;
+        }
+      }
+      elapsed[g] += nowNs() - start;
+    }
+  }
+  printf("%d sets of %.1f candidate routes, %.1f%% of the characters in a prefix shared with the route before\n",
+         setCount, (double) count / setCount, 100.0 * shared / chars);
+  printf("%-12s %10s %10s\n", "generation", "ns/route", "speed");
+  printf("%-12s %10.1f %9.2fx\n", "one by one", (double) elapsed[0] / ((double) TRIE_REPEATS * count), 1.0);
+  printf("%-12s %10.1f %9.2fx\n", "batch", (double) elapsed[1] / ((double) TRIE_REPEATS * count),
+         (double) elapsed[0] / elapsed[1]);
+  printf("%-12s %10.1f %9.2fx\n", "presorted", (double) elapsed[2] / ((double) TRIE_REPEATS * count),
+         (double) elapsed[0] / elapsed[2]);
+  free(store);
+  free(routes);
+  free(sorted);
+  free(sets);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: diagonal-bench replan|explore|codec|drive|stride|arena|generators|cmdqueue|strategy|trie [-n mazes] [-s seed] [-b budget] [-d usecs] [-f] [-p depth] [-m kbytes] [-w usecs] [-t bits] [--generator=name] [--compare=a,b] [-v] [maze files]\n");
+}
+
+int main(int argc, char** argv) {
+  benchOptions_t options;
+  if (argc < 2 || parseOptions(argc - 2, argv + 2, &options) != 0) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  if (strcmp(argv[1], "replan") == 0) {
+    return benchReplan(&options);
+  }
+  if (strcmp(argv[1], "explore") == 0) {
+    return benchExplore(&options);
+  }
+  if (strcmp(argv[1], "codec") == 0) {
+    return benchCodec(&options);
+  }
+  if (strcmp(argv[1], "drive") == 0) {
+    return benchDrive(&options);
+  }
+  if (strcmp(argv[1], "stride") == 0) {
+    return benchStride(&options);
+  }
+  if (strcmp(argv[1], "arena") == 0) {
+    return benchArena(&options);
+  }
+  if (strcmp(argv[1], "generators") == 0) {
+    return benchGenerators(&options);
+  }
+  if (strcmp(argv[1], "cmdqueue") == 0) {
+    return benchCommandQueue(&options);
+  }
+  if (strcmp(argv[1], "strategy") == 0) {
+    return benchStrategy(&options);
+  }
+  if (strcmp(argv[1], "trie") == 0) {
+    return benchTrie(&options);
+  }
+  usage();
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <sched.h>
+#include "cmdqueue.h"
+
+void commandQueueInit(commandQueue_t *queue) {
+  atomic_init(&queue->tail, 0);
+  atomic_init(&queue->head, 0);
+  queue->headCache = 0;
+  queue->tailCache = 0;
+}
+
+/*
+ * Producer only. Returns 1, or 0 if the queue is full.
+ */
+int commandQueuePush(commandQueue_t *queue, COMMAND cmd) {
+  unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  if (tail - queue->headCache == CMDQ_SIZE) {
+    queue->headCache = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - queue->headCache == CMDQ_SIZE) {
+      return 0;
+    }
+  }
+  queue->slots[tail & (CMDQ_SIZE - 1)] = cmd;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return 1;
+}
+
+/*
+ * Consumer only. Returns 1, or 0 if the queue is empty.
+ */
+int commandQueuePop(commandQueue_t *queue, COMMAND *cmd) {
+  unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  if (head == queue->tailCache) {
+    queue->tailCache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == queue->tailCache) {
+      return 0;
+    }
+  }
+  *cmd = queue->slots[head & (CMDQ_SIZE - 1)];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return 1;
+}
+
+void commandQueueSink(void *queue, COMMAND cmd) {
+  while (!commandQueuePush(queue, cmd)) {
+    sched_yield();
+  }
+}
+
+/*
+ * Send everything the calling thread emits to the queue, or back to the
+ * command list if queue is NULL.
+ */
+void commandQueueAttach(commandQueue_t *queue) {
+  setCommandSink(queue != NULL ? commandQueueSink : NULL, queue);
+}
@@ -0,0 +1,82 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef CMDQUEUE_H
+#define	CMDQUEUE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef __cplusplus
+#include <stdatomic.h>
+#endif
+#include "commands.h"
+
+  /*
+   * A single producer, single consumer ring of commands between the
+   * planner and the motion controller. The planner makes the queue its
+   * command sink with commandQueueAttach() and generates paths as usual;
+   * the controller pops each command as soon as it is emitted, so the
+   * mouse never has to stop while a new path is written and never reads
+   * a list that is half rewritten. CMD_STOP in the stream ends a path.
+   *
+   * Each index is written by one side only and sits on its own cache
+   * line, next to that side's cached copy of the other index, so the two
+   * threads only share a line when one of them has caught up with the
+   * other. The producer publishes a command with a release store of the
+   * tail and the consumer frees a slot with a release store of the head.
+   *
+   * Push and pop never block. The sink waits for room, yielding, since a
+   * planner can do nothing useful until the controller catches up.
+   *
+   * The indices are C11 atomics, so from C++ commandQueue_t is an opaque
+   * type that can only be used through a pointer.
+   */
+
+#define CMDQ_SIZE (256)   // a power of two
+
+  typedef struct commandQueue_s commandQueue_t;
+
+#ifndef __cplusplus
+  struct commandQueue_s {
+    _Alignas(64) atomic_uint tail;    // next slot to write, producer only
+    unsigned headCache;               // producer's last view of head
+    _Alignas(64) atomic_uint head;    // next slot to read, consumer only
+    unsigned tailCache;               // consumer's last view of tail
+    _Alignas(64) COMMAND slots[CMDQ_SIZE];
+  };
+#endif
+
+  void commandQueueInit(commandQueue_t *queue);
+  int commandQueuePush(commandQueue_t *queue, COMMAND cmd);
+  int commandQueuePop(commandQueue_t *queue, COMMAND *cmd);
+  void commandQueueSink(void *queue, COMMAND cmd);
+  void commandQueueAttach(commandQueue_t *queue);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CMDQUEUE_H */
+
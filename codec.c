@@ -0,0 +1,500 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "codec.h"
+
+/*
+ * See codec.h for the format.
+ */
+
+typedef struct {
+  uint8_t *p;
+  int size;     // bytes available
+  int bit;      // bits written or read so far
+} bits_t;
+
+static const COMMAND commonTurns[8] = {SS90SR, SS90SL, SD45R, SD45L, DS45R, DS45L, DD90R, DD90L};
+
+enum {
+  HUNT,
+  LENGTH,
+  START,
+  COUNT,
+  PAYLOAD,
+  CHECK
+};
+
+static uint8_t crc8(const uint8_t *data, int length) {
+  uint8_t crc = 0;
+  int i;
+  while (length-- > 0) {
+    crc ^= *data++;
+    for (i = 0; i < 8; i++) {
+      crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+    }
+  }
+  return crc;
+}
+
+static int putBits(bits_t *b, uint32_t value, int count) {
+  if (b->bit + count > 8 * b->size) {
+    return -1;
+  }
+  while (count-- > 0) {
+    uint8_t mask = 0x80 >> (b->bit & 7);
+    if (value & (1u << count)) {
+      b->p[b->bit >> 3] |= mask;
+    } else {
+      b->p[b->bit >> 3] &= ~mask;
+    }
+    b->bit++;
+  }
+  return 0;
+}
+
+static int getBits(bits_t *b, int count, uint32_t *value) {
+  uint32_t v = 0;
+  if (b->bit + count > 8 * b->size) {
+    return -1;
+  }
+  while (count-- > 0) {
+    v = (v << 1) | ((b->p[b->bit >> 3] >> (7 - (b->bit & 7))) & 1);
+    b->bit++;
+  }
+  *value = v;
+  return 0;
+}
+
+static int countBits(uint32_t value) {
+  int bits = 3;
+  while (value > 3) {
+    value >>= 2;
+    bits += 3;
+  }
+  return bits;
+}
+
+static int putCount(bits_t *b, uint32_t value) {
+  do {
+    uint32_t chunk = value & 3;
+    value >>= 2;
+    if (putBits(b, (value ? 4 : 0) | chunk, 3) != 0) {
+      return -1;
+    }
+  } while (value);
+  return 0;
+}
+
+static int getCount(bits_t *b, uint32_t *value) {
+  uint32_t chunk;
+  int shift = 0;
+  *value = 0;
+  do {
+    if (shift > 8 || getBits(b, 3, &chunk) != 0) {
+      return -1;
+    }
+    *value |= (chunk & 3) << shift;
+    shift += 2;
+  } while (chunk & 4);
+  return 0;
+}
+
+static int commonTurnIndex(COMMAND cmd) {
+  int i;
+  for (i = 0; i < 8; i++) {
+    if (commonTurns[i] == cmd) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The number of bits needed for a single command.
+ */
+static int commandBits(COMMAND cmd) {
+  if (cmd == CMD_STOP) {
+    return 6;
+  }
+  if (cmd <= CMD_SQUARES) {
+    return 1 + countBits(cmd - FWD1);
+  }
+  if (cmd < CMD_TURN) {
+    return 2 + countBits(cmd - DIA0);
+  }
+  if (commonTurnIndex(cmd) >= 0) {
+    return 6;
+  }
+  if (cmd <= SS90EL) {
+    return 9;
+  }
+  return 14;
+}
+
+static int putCommand(bits_t *b, COMMAND cmd) {
+  int common = commonTurnIndex(cmd);
+  if (cmd == CMD_STOP) {
+    return putBits(b, 0x3E, 6);
+  }
+  if (cmd <= CMD_SQUARES) {
+    return putBits(b, 0, 1) | putCount(b, cmd - FWD1);
+  }
+  if (cmd < CMD_TURN) {
+    return putBits(b, 2, 2) | putCount(b, cmd - DIA0);
+  }
+  if (common >= 0) {
+    return putBits(b, 0x30 | common, 6);
+  }
+  if (cmd <= SS90EL) {
+    return putBits(b, 0x1C0 | (cmd - IP45R), 9);
+  }
+  return putBits(b, 0x3F00 | cmd, 14);
+}
+
+/*
+ * Encode n commands as one frame. At each position the longest run that
+ * repeats one of the last four blocks is found and a repeat is used if it
+ * takes fewer bits than the commands themselves.
+ * Returns the number of bytes written or -1 if there is no room.
+ */
+static int encodeFrame(const COMMAND *cmds, int n, int start, uint8_t *out, int capacity) {
+  bits_t b;
+  int i = 0;
+  int bytes;
+  if (capacity < CODEC_FRAME_OVERHEAD) {
+    return -1;
+  }
+  b.p = out + CODEC_FRAME_HEADER;
+  b.size = (capacity - CODEC_FRAME_OVERHEAD < CODEC_MAX_PAYLOAD) ? capacity - CODEC_FRAME_OVERHEAD : CODEC_MAX_PAYLOAD;
+  b.bit = 0;
+  while (i < n) {
+    int bestPeriod = 0;
+    int bestRepeats = 0;
+    int bestSaving = 0;
+    int p;
+    for (p = 1; p <= 4 && p <= i; p++) {
+      int run = 0;
+      int plain = 0;
+      int saving;
+      while (i + run < n && cmds[i + run] == cmds[i + run - p] && cmds[i + run] != CMD_STOP) {
+        run++;
+      }
+      run -= run % p;
+      if (run == 0) {
+        continue;
+      }
+      for (int k = 0; k < run; k++) {
+        plain += commandBits(cmds[i + k]);
+      }
+      saving = plain - (7 + countBits(run / p - 1));
+      if (saving > bestSaving) {
+        bestSaving = saving;
+        bestPeriod = p;
+        bestRepeats = run / p;
+      }
+    }
+    if (bestPeriod) {
+      if (putBits(&b, 0x78 | (bestPeriod - 1), 7) != 0 || putCount(&b, bestRepeats - 1) != 0) {
+        return -1;
+      }
+      i += bestPeriod * bestRepeats;
+    } else {
+      if (putCommand(&b, cmds[i]) != 0) {
+        return -1;
+      }
+      i++;
+    }
+  }
+  bytes = (b.bit + 7) / 8;
+  if (b.bit & 7) {
+    putBits(&b, 0, 8 - (b.bit & 7));
+  }
+  out[0] = CODEC_SYNC;
+  out[1] = (uint8_t) bytes;
+  out[2] = (uint8_t) start;
+  out[3] = (uint8_t) n;
+  out[CODEC_FRAME_HEADER + bytes] = crc8(out, CODEC_FRAME_HEADER + bytes);
+  return CODEC_FRAME_OVERHEAD + bytes;
+}
+
+void encoderInit(encoder_t *encoder, uint8_t *out, int capacity, int frameCommands) {
+  encoder->out = out;
+  encoder->capacity = capacity;
+  encoder->length = 0;
+  encoder->pending = 0;
+  encoder->sent = 0;
+  if (frameCommands < 1 || frameCommands > CODEC_FRAME_COMMANDS) {
+    frameCommands = CODEC_FRAME_COMMANDS;
+  }
+  encoder->frameCommands = frameCommands;
+}
+
+/*
+ * Send whatever commands are waiting as a frame.
+ * Returns 0 on success or -1 if the output is full.
+ */
+int encoderFlush(encoder_t *encoder) {
+  int n;
+  if (encoder->pending == 0) {
+    return 0;
+  }
+  n = encodeFrame(encoder->commands, encoder->pending, encoder->sent,
+          encoder->out + encoder->length, encoder->capacity - encoder->length);
+  if (n < 0) {
+    return -1;
+  }
+  encoder->length += n;
+  encoder->sent += encoder->pending;
+  encoder->pending = 0;
+  return 0;
+}
+
+/*
+ * Add one command to the stream. A frame is sent when it is full or when
+ * CMD_STOP ends the list, so a path can be streamed while it is being
+ * generated. Returns 0 on success or -1 if the output is full.
+ */
+int encodeCommand(encoder_t *encoder, COMMAND cmd) {
+  encoder->commands[encoder->pending++] = cmd;
+  if (encoder->pending == encoder->frameCommands || cmd == CMD_STOP) {
+    return encoderFlush(encoder);
+  }
+  return 0;
+}
+
+/*
+ * Encode a whole CMD_STOP terminated list.
+ * Returns the number of bytes written or -1 if they do not fit.
+ */
+int encodeList(const COMMAND *list, uint8_t *out, int capacity, int frameCommands) {
+  encoder_t encoder;
+  int i = 0;
+  encoderInit(&encoder, out, capacity, frameCommands);
+  do {
+    if (encodeCommand(&encoder, list[i]) != 0) {
+      return -1;
+    }
+  } while (list[i++] != CMD_STOP && i < COMMAND_LIST_SIZE);
+  if (encoderFlush(&encoder) != 0) {
+    return -1;
+  }
+  return encoder.length;
+}
+
+/*
+ * Decoding writes straight into the caller's list, commandList if it
+ * likes, which is kept terminated after every frame so that whatever
+ * has arrived so far can be used.
+ */
+void decoderInit(decoder_t *decoder, COMMAND *out, int capacity) {
+  decoder->out = out;
+  decoder->capacity = capacity;
+  decoder->count = 0;
+  decoder->frames = 0;
+  decoder->badFrames = 0;
+  decoder->complete = 0;
+  decoder->gap = 0;
+  decoder->state = HUNT;
+  decoder->index = 0;
+  if (capacity > 0) {
+    out[0] = CMD_STOP;
+  }
+}
+
+/*
+ * Unpack the payload of a frame that passed its CRC check. Nothing is
+ * written unless the whole frame decodes to the expected count, fits and
+ * carries on from the end of the list so far. Once a frame has been
+ * missed nothing more is added.
+ * Returns the number of commands added or -1.
+ */
+static int decodeFrame(decoder_t *decoder) {
+  COMMAND cmds[256];
+  bits_t b;
+  int expected = decoder->frame[3];
+  int n = 0;
+  int stop = 0;
+  int i;
+  if (decoder->gap || decoder->frame[2] != (decoder->count & 0xFF)) {
+    decoder->gap = 1;
+    return -1;
+  }
+  b.p = decoder->frame + CODEC_FRAME_HEADER;
+  b.size = decoder->frame[1];
+  b.bit = 0;
+  while (n < expected) {
+    uint32_t v;
+    uint32_t prefix = 0;
+    int ones = 0;
+    while (ones < 6) {
+      if (getBits(&b, 1, &prefix) != 0) {
+        return -1;
+      }
+      if (prefix == 0) {
+        break;
+      }
+      ones++;
+    }
+    if (ones == 0) {
+      if (getCount(&b, &v) != 0 || v >= CMD_SQUARES) {
+        return -1;
+      }
+      cmds[n++] = FWD1 + v;
+    } else if (ones == 1) {
+      if (getCount(&b, &v) != 0 || v > CMD_SQUARES) {
+        return -1;
+      }
+      cmds[n++] = DIA0 + v;
+    } else if (ones == 2) {
+      if (getBits(&b, 3, &v) != 0) {
+        return -1;
+      }
+      cmds[n++] = commonTurns[v];
+    } else if (ones == 3) {
+      if (getBits(&b, 5, &v) != 0 || v >= TURN_COUNT) {
+        return -1;
+      }
+      cmds[n++] = IP45R + v;
+    } else if (ones == 4) {
+      uint32_t period;
+      uint32_t repeats;
+      if (getBits(&b, 2, &period) != 0 || getCount(&b, &repeats) != 0) {
+        return -1;
+      }
+      period++;
+      repeats = (repeats + 1) * period;
+      if (period > (uint32_t) n || n + repeats > (uint32_t) expected) {
+        return -1;
+      }
+      while (repeats-- > 0) {
+        cmds[n] = cmds[n - period];
+        n++;
+      }
+    } else if (ones == 5) {
+      cmds[n++] = CMD_STOP;
+    } else {
+      if (getBits(&b, 8, &v) != 0) {
+        return -1;
+      }
+      cmds[n++] = v;
+    }
+  }
+  for (i = 0; i < n; i++) {
+    if (cmds[i] == CMD_STOP) {
+      n = i;
+      stop = 1;
+      break;
+    }
+  }
+  if (decoder->count + n >= decoder->capacity) {
+    return -1;
+  }
+  memcpy(decoder->out + decoder->count, cmds, n);
+  decoder->count += n;
+  decoder->out[decoder->count] = CMD_STOP;
+  decoder->complete |= stop;
+  return n;
+}
+
+/*
+ * Drop the frame collected so far and search it again from the byte
+ * after its sync.
+ */
+static int resync(decoder_t *decoder) {
+  uint8_t replay[CODEC_MAX_FRAME];
+  int length = decoder->index - 1;
+  memcpy(replay, decoder->frame + 1, length);
+  decoder->badFrames++;
+  decoder->state = HUNT;
+  return decodeBytes(decoder, replay, length);
+}
+
+/*
+ * Feed one received byte to the decoder.
+ * Returns the number of commands that became available, which is only
+ * ever non-zero on the last byte of a good frame. A frame that fails its
+ * check is searched again from the byte after its sync.
+ */
+int decodeByte(decoder_t *decoder, uint8_t byte) {
+  int added = 0;
+  switch (decoder->state) {
+    case HUNT:
+      if (byte == CODEC_SYNC) {
+        decoder->frame[0] = byte;
+        decoder->index = 1;
+        decoder->state = LENGTH;
+      }
+      break;
+    case LENGTH:
+      decoder->frame[decoder->index++] = byte;
+      if (byte > CODEC_MAX_PAYLOAD) {
+        return resync(decoder);
+      }
+      decoder->state = START;
+      break;
+    case START:
+      decoder->frame[decoder->index++] = byte;
+      decoder->state = COUNT;
+      break;
+    case COUNT:
+      decoder->frame[decoder->index++] = byte;
+      if (byte == 0 || byte > CODEC_FRAME_COMMANDS) {
+        return resync(decoder);
+      }
+      decoder->state = decoder->frame[1] ? PAYLOAD : CHECK;
+      break;
+    case PAYLOAD:
+      decoder->frame[decoder->index++] = byte;
+      if (decoder->index == CODEC_FRAME_HEADER + decoder->frame[1]) {
+        decoder->state = CHECK;
+      }
+      break;
+    default:
+      if (byte != crc8(decoder->frame, decoder->index)) {
+        decoder->frame[decoder->index++] = byte;
+        return resync(decoder);
+      }
+      decoder->state = HUNT;
+      added = decodeFrame(decoder);
+      if (added < 0) {
+        decoder->badFrames++;
+        added = 0;
+      } else {
+        decoder->frames++;
+      }
+      break;
+  }
+  return added;
+}
+
+/*
+ * Feed a block of received bytes. Returns the number of commands added.
+ */
+int decodeBytes(decoder_t *decoder, const uint8_t *in, int length) {
+  int added = 0;
+  while (length-- > 0) {
+    added += decodeByte(decoder, *in++);
+  }
+  return added;
+}
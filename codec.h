@@ -0,0 +1,113 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef CODEC_H
+#define	CODEC_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+
+  /*
+   * A compact encoding of command lists for the telemetry link.
+   *
+   * Commands are packed MSB first with a prefix code for each family:
+   *
+   *   0       + count  FWDn, count is n-1
+   *   10      + count  DIAn
+   *   110     + 3 bits one of the common turns SS90S, SD45, DS45, DD90
+   *   1110    + 5 bits any other turn
+   *   11110   + 2 bits + count  repeat the last p commands, p is 1 to 4
+   *   111110           CMD_STOP
+   *   111111  + 8 bits any other byte, such as an error
+   *
+   * A count is a varint of 3 bit groups, a continuation bit and two bits
+   * of value, least significant first, so counts below four take 3 bits.
+   *
+   * The bits are sent in frames so that a receiver can start anywhere and
+   * use every frame that arrived intact:
+   *
+   *   0xA5, payload length, start, command count, payload, CRC-8 of all before it
+   *
+   * start is the index in the list of the first command in the frame,
+   * modulo 256. Each frame stands alone so a repeat never refers to an
+   * earlier frame, but frames are only used in order: a frame that does
+   * not start where the list so far ends means one was lost, and nothing
+   * after the gap is added. The list the decoder holds is therefore always
+   * a prefix of the one sent, and it is only complete if nothing is
+   * missing before its CMD_STOP.
+   * A frame holds at most CODEC_FRAME_COMMANDS commands so a header that
+   * claims more, or a longer payload, is rejected at once. When a frame
+   * fails its check the decoder looks for the next sync byte inside it,
+   * so a damaged length byte costs no more than the frame it belongs to.
+   * The encoder and decoder use fixed buffers and never allocate.
+   */
+
+#define CODEC_SYNC           (0xA5)
+#define CODEC_FRAME_COMMANDS (32)
+#define CODEC_MAX_PAYLOAD    ((CODEC_FRAME_COMMANDS * 14 + 7) / 8)
+#define CODEC_FRAME_HEADER   (4)   // sync, length, start and count
+#define CODEC_FRAME_OVERHEAD (CODEC_FRAME_HEADER + 1)   // and the check byte
+#define CODEC_MAX_FRAME      (CODEC_MAX_PAYLOAD + CODEC_FRAME_OVERHEAD)
+
+  typedef struct {
+    uint8_t *out;
+    int capacity;
+    int length;
+    int frameCommands;
+    int pending;
+    int sent;                // commands already in frames
+    COMMAND commands[CODEC_FRAME_COMMANDS];
+  } encoder_t;
+
+  typedef struct {
+    COMMAND *out;
+    int capacity;
+    int count;               // commands decoded so far
+    int frames;              // good frames
+    int badFrames;           // frames dropped for a bad CRC, bad contents or a gap
+    int complete;            // CMD_STOP has been received
+    int gap;                 // a frame was lost, nothing after it is used
+    int state;
+    int index;
+    uint8_t frame[CODEC_MAX_FRAME];
+  } decoder_t;
+
+  void encoderInit(encoder_t *encoder, uint8_t *out, int capacity, int frameCommands);
+  int encodeCommand(encoder_t *encoder, COMMAND cmd);
+  int encoderFlush(encoder_t *encoder);
+  int encodeList(const COMMAND *list, uint8_t *out, int capacity, int frameCommands);
+
+  void decoderInit(decoder_t *decoder, COMMAND *out, int capacity);
+  int decodeByte(decoder_t *decoder, uint8_t byte);
+  int decodeBytes(decoder_t *decoder, const uint8_t *in, int length);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CODEC_H */
+
@@ -22,9 +22,11 @@ THE SOFTWARE.
  */
 
 #include "stdio.h"
+#include <stdlib.h>
+#include <string.h>
 #include "commands.h"
 
-COMMAND commandList[256];
+COMMAND commandList[COMMAND_LIST_SIZE];
 
 static const char *turnNames[] = {
   "IP45R",    // In Place 45 degree Right
@@ -55,7 +57,84 @@ static const char *turnNames[] = {
   "SS90EL"
 };
 
-static int cmdIndex = 0;
+static const char *integratedNames[] = {
+  "SD45R_DS45L",
+  "SD45L_DS45R",
+  "SD45R_DS135L",
+  "SD45L_DS135R",
+  "SD45R_DD90L",
+  "SD45L_DD90R",
+  "SD135R_DS45L",
+  "SD135L_DS45R",
+  "SD135R_DS135L",
+  "SD135L_DS135R",
+  "SD135R_DD90L",
+  "SD135L_DD90R",
+  "DD90R_DS45L",
+  "DD90L_DS45R",
+  "DD90R_DS135L",
+  "DD90L_DS135R",
+  "DD90R_DD90L",
+  "DD90L_DD90R"
+};
+
+static const COMMAND integratedEntry[3] = {SD45R, SD135R, DD90R};
+static const COMMAND integratedExit[3] = {DS45R, DS135R, DD90R};
+
+static CMD_THREAD_LOCAL int cmdIndex = 0;
+static CMD_THREAD_LOCAL COMMAND *cmdBuffer = NULL;
+static CMD_THREAD_LOCAL int cmdSize = 0;
+static CMD_THREAD_LOCAL commandSinkFn cmdSink = NULL;
+static CMD_THREAD_LOCAL void *cmdSinkContext = NULL;
+
+/*
+ * Commands normally go to commandList but they can be sent to any buffer,
+ * such as the free end of an arena, so that a path is generated in place
+ * rather than copied out afterwards. A NULL buffer goes back to the
+ * commandList. The buffer is cleared ready for a new path.
+ */
+void setCommandBuffer(COMMAND *buffer, int size) {
+  if (buffer == NULL) {
+    buffer = commandList;
+    size = COMMAND_LIST_SIZE;
+  }
+  cmdBuffer = buffer;
+  cmdSize = size;
+  clearCommands();
+}
+
+/*
+ * Send every command this thread emits to a sink, such as a queue to the
+ * motion controller, instead of to a buffer, so that the commands can be
+ * used while the rest of the path is still being generated. A NULL sink
+ * goes back to the buffer.
+ */
+void setCommandSink(commandSinkFn sink, void *context) {
+  cmdSink = sink;
+  cmdSinkContext = context;
+}
+
+void getCommandSink(commandSinkFn *sink, void **context) {
+  *sink = cmdSink;
+  *context = cmdSinkContext;
+}
+
+/*
+ * The buffer this thread emits to, NULL for the commandList, so that a
+ * function that sets its own can put the caller's back afterwards.
+ */
+void getCommandBuffer(COMMAND **buffer, int *size) {
+  *buffer = cmdBuffer == commandList ? NULL : cmdBuffer;
+  *size = cmdSize;
+}
+
+/*
+ * The number of commands emitted since the buffer was last cleared,
+ * including any terminating CMD_STOP.
+ */
+int commandCount(void) {
+  return cmdIndex;
+}
 
 /*
  * The command list is null-terminated so it should only be necessary
@@ -63,8 +142,12 @@ static int cmdIndex = 0;
  * CMD_STOP has the value zero.
  */
 void clearCommands(void) {
+  if (cmdBuffer == NULL) {
+    cmdBuffer = commandList;
+    cmdSize = COMMAND_LIST_SIZE;
+  }
   cmdIndex = 0;
-  commandList[0] = CMD_STOP;
+  cmdBuffer[0] = CMD_STOP;
 }
 
 /*
@@ -73,10 +156,115 @@ void clearCommands(void) {
  * least there will be no overflow
  */
 void emitCommand(COMMAND cmd) {
-  if (cmdIndex >= sizeof (commandList)) {
-    return; // TODO: fails silently. Think of a better solution
+  if (cmdSink != NULL) {
+    cmdSink(cmdSinkContext, cmd);
+    return;
+  }
+  if (cmdIndex >= cmdSize) {
+    if (cmdBuffer != NULL) {
+      return; // TODO: fails silently. Think of a better solution
+    }
+    cmdBuffer = commandList;
+    cmdSize = COMMAND_LIST_SIZE;
+  }
+  cmdBuffer[cmdIndex++] = cmd;
+}
+
+/*
+ * The name of a single command as it is written in the command tables,
+ * such as FWD3, DIA2 or SD45R.
+ */
+int formatCommand(COMMAND command, char *text, int size) {
+  if (command == CMD_END) {
+    return snprintf(text, size, "END");
+  } else if (command == CMD_STOP) {
+    return snprintf(text, size, "STOP");
+  } else if (command <= CMD_SQUARES) {
+    return snprintf(text, size, "FWD%d", command - FWD0);
+  } else if (command < CMD_TURN) {
+    return snprintf(text, size, "DIA%d", command - DIA0);
+  } else if (command <= SS90EL) {
+    return snprintf(text, size, "%s", turnNames[command - IP45R]);
+  } else if (command >= CMD_INTEGRATED && command < CMD_INTEGRATED + INTEGRATED_COUNT) {
+    return snprintf(text, size, "%s", integratedNames[command - CMD_INTEGRATED]);
+  } else if (command >= CMD_ERROR_00) {
+    return snprintf(text, size, "ERR_%02d", command - CMD_ERROR_00);
   }
-  commandList[cmdIndex++] = cmd;
+  return snprintf(text, size, "UNKNOWN");
+}
+
+/*
+ * The command named by the text, which is anything formatCommand() gives
+ * for a movement command. Returns 0, or -1 if the name is not known.
+ */
+int parseCommand(const char *text, COMMAND *command) {
+  char *end;
+  long n;
+  int i;
+  if (strncmp(text, "FWD", 3) == 0 || strncmp(text, "DIA", 3) == 0) {
+    n = strtol(text + 3, &end, 10);
+    if (end == text + 3 || *end != 0 || n < 0 || n > CMD_SQUARES) {
+      return -1;
+    }
+    *command = (text[0] == 'F' ? CMD_STRAIGHT : CMD_DIAGONAL) + n;
+    return 0;
+  }
+  if (strcmp(text, "STOP") == 0) {
+    *command = CMD_STOP;
+    return 0;
+  }
+  for (i = 0; i < TURN_COUNT; i++) {
+    if (strcmp(text, turnNames[i]) == 0) {
+      *command = IP45R + i;
+      return 0;
+    }
+  }
+  for (i = 0; i < INTEGRATED_COUNT; i++) {
+    if (strcmp(text, integratedNames[i]) == 0) {
+      *command = CMD_INTEGRATED + i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The separate commands an integrated turn stands for, its entry turn,
+ * DIA2 and its exit turn. Returns INTEGRATED_PARTS, or 0 if the command
+ * is not an integrated turn.
+ */
+int integratedParts(COMMAND command, COMMAND *parts) {
+  int index = command - CMD_INTEGRATED;
+  int direction;
+  if (index < 0 || index >= INTEGRATED_COUNT) {
+    return 0;
+  }
+  direction = index & CMD_LEFT;
+  parts[0] = integratedEntry[index / 6] + direction;
+  parts[1] = DIA2;
+  parts[2] = integratedExit[index / 2 % 3] + (direction ^ CMD_LEFT);
+  return INTEGRATED_PARTS;
+}
+
+/*
+ * The integrated turn for entry, diagonal, exit, or CMD_STOP if there is
+ * none.
+ */
+COMMAND integrateTurns(COMMAND entry, COMMAND diagonal, COMMAND exit) {
+  int direction = (entry - CMD_TURN) & CMD_LEFT;
+  int e;
+  int x;
+  if (diagonal != DIA2 || ((exit - CMD_TURN) & CMD_LEFT) == direction) {
+    return CMD_STOP;
+  }
+  for (e = 0; e < 3 && integratedEntry[e] != entry - direction; e++) {
+  }
+  for (x = 0; x < 3 && integratedExit[x] != exit - (direction ^ CMD_LEFT); x++) {
+  }
+  if (e == 3 || x == 3) {
+    return CMD_STOP;
+  }
+  return CMD_INTEGRATED + 6 * e + 2 * x + direction;
 }
 
 /*
@@ -87,22 +275,19 @@ void emitCommand(COMMAND cmd) {
 void listCommands(void) {
   int p = 0;
   COMMAND command;
+  char name[16];
   while ((p < cmdIndex) ) {
-    command = commandList[p++];
+    command = cmdBuffer[p++];
     if (command == CMD_END) {
       printf("Finished\n");
     } else if (command == CMD_STOP) {
       printf("STOP");
-    } else if (command < FWD16) {
-      printf("FWD%d, ", command - FWD0);
-    } else if (command < DIA31) {
-      printf("DIA%d, ", command - DIA0);
-    } else if (command < CMD_END) {
-      printf("%s, ", turnNames[command - IP45R]);
-    } else if (command >= CMD_ERROR_00) {
-      printf("ERR_%02d, ", command - CMD_ERROR_00);
-    } else {
+    } else if (command > SS90EL && command < CMD_ERROR_00
+            && (command < CMD_INTEGRATED || command >= CMD_INTEGRATED + INTEGRATED_COUNT)) {
       printf("UNKNOWN ERROR");
+    } else {
+      formatCommand(command, name, sizeof (name));
+      printf("%s, ", name);
     }
   }
   printf("\n");
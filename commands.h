@@ -46,6 +46,12 @@ extern "C" {
    *                            10 => 135 deg
    *                            11 => 180 deg
    *        B5:B3 = turn type   00 => in-place
+   * 011 => integrated turns. A turn onto a diagonal, the shortest diagonal
+   *        DIA2 and a turn off it, driven as one manoeuvre with no change
+   *        of speed between the turns. The turns go opposite ways.
+   *        B4:0  = 6 * entry + 2 * exit + direction of the entry turn
+   *        entry   0 => SD45, 1 => SD135, 2 => DD90
+   *        exit    0 => DS45, 1 => DS135, 2 => DD90
    *
    * 1xx => error
    *
@@ -160,13 +166,77 @@ typedef uint8_t COMMAND;
 #define SS90ER  (CMD_TURN + 24)     //88
 #define SS90EL  (CMD_TURN + 25)     //89
 
+#define SD45R_DS45L     (CMD_INTEGRATED +  0)   //96
+#define SD45L_DS45R     (CMD_INTEGRATED +  1)   //97
+#define SD45R_DS135L    (CMD_INTEGRATED +  2)   //98
+#define SD45L_DS135R    (CMD_INTEGRATED +  3)   //99
+#define SD45R_DD90L     (CMD_INTEGRATED +  4)   //100
+#define SD45L_DD90R     (CMD_INTEGRATED +  5)   //101
+#define SD135R_DS45L    (CMD_INTEGRATED +  6)   //102
+#define SD135L_DS45R    (CMD_INTEGRATED +  7)   //103
+#define SD135R_DS135L   (CMD_INTEGRATED +  8)   //104
+#define SD135L_DS135R   (CMD_INTEGRATED +  9)   //105
+#define SD135R_DD90L    (CMD_INTEGRATED + 10)   //106
+#define SD135L_DD90R    (CMD_INTEGRATED + 11)   //107
+#define DD90R_DS45L     (CMD_INTEGRATED + 12)   //108
+#define DD90L_DS45R     (CMD_INTEGRATED + 13)   //109
+#define DD90R_DS135L    (CMD_INTEGRATED + 14)   //110
+#define DD90L_DS135R    (CMD_INTEGRATED + 15)   //111
+#define DD90R_DD90L     (CMD_INTEGRATED + 16)   //112
+#define DD90L_DD90R     (CMD_INTEGRATED + 17)   //113
+
+#define TURN_COUNT         (SS90EL - IP45R + 1)
+#define INTEGRATED_COUNT   (DD90L_DD90R - CMD_INTEGRATED + 1)
+#define INTEGRATED_PARTS   (3)
+#define COMMAND_LIST_SIZE  (256)
 
+  /*
+   * Not every mouse can drive every command. These bits describe what a
+   * mouse is able to do so that optional passes only produce commands
+   * it can execute. CAP_ALL is the classic command set; integrated turns
+   * need a controller that knows them and are left out of it.
+   */
+#define CAP_IN_PLACE    (0x01)  // IPxx turns
+#define CAP_SMOOTH_90   (0x02)  // SS90xx turns
+#define CAP_SMOOTH_180  (0x04)  // SS180x turns
+#define CAP_DIAGONAL    (0x08)  // DIAn and the SD, DS and DD turns
+#define CAP_ALL         (0x0F)
+#define CAP_INTEGRATED  (0x10)  // integrated turns, only on request
+
+  /*
+   * commandList is one list shared by every thread. What emitCommand()
+   * writes to, the buffer, its index and the sink, is per thread when
+   * CMD_THREADS is defined, as it is for the host tools, so that threads
+   * generating paths at once can each hand setCommandBuffer() a buffer of
+   * their own. Without it they are plain globals, for a target with no
+   * thread local storage.
+   */
+#ifdef CMD_THREADS
+#ifdef __cplusplus
+#define CMD_THREAD_LOCAL thread_local
+#else
+#define CMD_THREAD_LOCAL _Thread_local
+#endif
+#else
+#define CMD_THREAD_LOCAL
+#endif
+
+  extern COMMAND commandList[COMMAND_LIST_SIZE];
 
-  extern COMMAND commandList[];
+  typedef void (*commandSinkFn)(void *context, COMMAND cmd);
 
   void listCommands (void);
+  int formatCommand(COMMAND command, char *text, int size);
+  int parseCommand(const char *text, COMMAND *command);
+  int integratedParts(COMMAND command, COMMAND *parts);
+  COMMAND integrateTurns(COMMAND entry, COMMAND diagonal, COMMAND exit);
   void clearCommands (void);
   void emitCommand (COMMAND cmd);
+  void setCommandBuffer(COMMAND *buffer, int size);
+  void setCommandSink(commandSinkFn sink, void *context);
+  void getCommandSink(commandSinkFn *sink, void **context);
+  void getCommandBuffer(COMMAND **buffer, int *size);
+  int commandCount(void);
   int compareCommands(COMMAND *s1, COMMAND *s2, unsigned int n) ;
 
 #ifdef	__cplusplus
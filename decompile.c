@@ -0,0 +1,145 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include "decompile.h"
+
+static char turnChar(COMMAND cmd) {
+  return ((cmd - CMD_TURN) & CMD_LEFT) ? 'L' : 'R';
+}
+
+static char otherTurn(char c) {
+  return c == 'R' ? 'L' : 'R';
+}
+
+/*
+ * Rebuild the route for a CMD_STOP terminated list in one pass, with the
+ * S for the goal cell and a terminating zero, so that
+ * makeDiagonalPath(route) gives the same list back.
+ *
+ * Returns -1 on success or the index of the first command that cannot
+ * appear where it does, in the same way as compareCommands(). The route
+ * up to that point is left in the buffer. Running out of room is
+ * reported at the command that needed it, and a list with no CMD_STOP in
+ * its first COMMAND_LIST_SIZE commands at the last of them.
+ */
+int decompilePath(const COMMAND *list, char *route, int size) {
+  int diagonal = 0;   // on a diagonal run
+  int pending = 1;    // the next straight includes the move made by the last turn
+  char next = 0;      // the next turn on a diagonal
+  char last = 0;      // the last turn on a diagonal
+  COMMAND parts[INTEGRATED_PARTS];
+  int part = 0;       // the next part of an integrated turn
+  int count = 0;      // the parts of the command at i
+  int length = 0;
+  int i;
+  if (size < 2) {
+    return 0;
+  }
+  if (list[0] == CMD_STOP) {
+    route[0] = 'S';       // the mouse is already in the goal
+    route[1] = 0;
+    return -1;
+  }
+  route[length++] = 'F';
+  /* integrated turns are read one part at a time and i only moves on after the last */
+  for (i = 0; i < COMMAND_LIST_SIZE; i += (part == count)) {
+    COMMAND cmd;
+    int cells = 0;
+    char c = 'F';
+    if (part == count) {
+      count = integratedParts(list[i], parts);
+      if (count == 0) {
+        parts[0] = list[i];
+        count = 1;
+      }
+      part = 0;
+    }
+    cmd = parts[part++];
+    if (cmd == CMD_STOP) {
+      if (diagonal || pending) {
+        break;
+      }
+      route[length++] = 'S';
+      route[length] = 0;
+      return -1;
+    } else if (cmd <= CMD_SQUARES) {
+      if (diagonal) {
+        break;
+      }
+      cells = cmd - FWD0 - pending;
+      pending = 0;
+    } else if (cmd < CMD_TURN) {
+      if (!diagonal || cmd == DIA0) {
+        break;
+      }
+      cells = cmd - DIA0;
+      c = next;
+    } else if (cmd == IP90R || cmd == IP90L || (cmd >= SS90SR && cmd <= SS180L) || cmd == SS90ER || cmd == SS90EL) {
+      if (diagonal || pending) {
+        break;
+      }
+      cells = (cmd == SS180R || cmd == SS180L) ? 2 : 1;
+      c = turnChar(cmd);
+      pending = 1;
+    } else if (cmd >= SD45R && cmd <= SD135L) {
+      if (diagonal || pending) {
+        break;
+      }
+      diagonal = 1;
+      next = turnChar(cmd);
+      cells = (cmd >= SD135R) ? 1 : 0;
+      c = next;
+    } else if (cmd >= DS45R && cmd <= DS135L) {
+      if (!diagonal || turnChar(cmd) != last) {
+        break;
+      }
+      diagonal = 0;
+      pending = 1;
+      cells = (cmd >= DS135R) ? 1 : 0;
+      c = last;
+    } else if (cmd == DD90R || cmd == DD90L) {
+      if (!diagonal || turnChar(cmd) != last) {
+        break;
+      }
+      next = last;
+      continue;
+    } else {
+      break;
+    }
+    if (cells < 0 || length + cells + 2 > size) {
+      break;
+    }
+    while (cells-- > 0) {
+      route[length++] = c;
+      if (cmd > CMD_SQUARES && cmd < CMD_TURN) {
+        last = c;
+        c = otherTurn(c);
+      }
+    }
+    if (cmd > CMD_SQUARES && cmd < CMD_TURN) {
+      next = c;
+    }
+  }
+  route[length] = 0;
+  return i < COMMAND_LIST_SIZE ? i : COMMAND_LIST_SIZE - 1;
+}
@@ -0,0 +1,61 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef DECOMPILE_H
+#define	DECOMPILE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "commands.h"
+
+  /*
+   * Turn a command list back into the route string it was generated from.
+   *
+   * Every cell of the route is one character. A turn character includes
+   * the move into the next cell so a straight after a turn stands for one
+   * cell fewer than its length, and the route always starts with the F
+   * that leaves the start cell. On a diagonal each DIA step is one cell
+   * and the turns alternate, starting with the direction of the turn
+   * onto the diagonal. SD135 and DS135 each add one more turn in the same
+   * direction and DD90 repeats the last turn of the run before it. An
+   * integrated turn is read as its entry turn, DIA2 and exit turn.
+   *
+   * IP90 turns are read as smooth turns since they take the mouse
+   * through the same cells. The other in-place turns have no place in a
+   * route.
+   *
+   * Returns -1 on success or the index of the first command that cannot
+   * appear where it does. A list with no CMD_STOP in its first
+   * COMMAND_LIST_SIZE commands is reported at COMMAND_LIST_SIZE - 1, so
+   * the result is always an index into the list.
+   */
+
+  int decompilePath(const COMMAND *list, char *route, int size);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DECOMPILE_H */
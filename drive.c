@@ -0,0 +1,358 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "drive.h"
+
+#define PI_F (3.14159265f)
+#define MAX_CORNERS (2 * COMMAND_LIST_SIZE + 2)
+
+/*
+ * A classic size mouse in a standard maze. The turn radii are chosen so
+ * that every list the generator can produce fits the straights it
+ * leaves between turns.
+ */
+const mouseModel_t defaultMouseModel = {
+  180.0f, 12.0f, 35.0f, 5.0f,
+  {
+    0.0f, 0.0f, // IP45
+    0.0f, 0.0f, // IP90
+    0.0f, 0.0f, // IP135
+    0.0f, 0.0f, // IP180
+    90.0f, 90.0f, // SS90S
+    90.0f, 90.0f, // SS90F
+    90.0f, 90.0f, // SS180
+    150.0f, 150.0f, // SD45
+    50.0f, 50.0f, // SD135
+    150.0f, 150.0f, // DS45
+    50.0f, 50.0f, // DS135
+    60.0f, 60.0f, // DD90
+    90.0f, 90.0f, // SS90E
+  }
+};
+
+typedef struct {
+  float x;
+  float y;
+  float radius;
+  float tangent;
+  int8_t turn;
+  uint8_t headingIn;
+  uint8_t headingOut;
+  uint8_t command;
+} corner_t;
+
+/*
+ * Samples are collected in batches so that the collision test is a
+ * simple loop over arrays.
+ */
+typedef struct {
+  const maze_t *maze;
+  const mouseModel_t *mouse;
+  tracePoint_t *trace;
+  int traceSize;
+  driveResult_t *result;
+  int n;
+  float x[DRIVE_BATCH];
+  float y[DRIVE_BATCH];
+  float heading[DRIVE_BATCH];
+  uint8_t command[DRIVE_BATCH];
+} sampler_t;
+
+static float unitX(int heading) {
+  return (heading & 1) ? headingDX[heading] * 0.70710678f : headingDX[heading];
+}
+
+static float unitY(int heading) {
+  return (heading & 1) ? headingDY[heading] * 0.70710678f : headingDY[heading];
+}
+
+static float headingAngle(int heading) {
+  return heading * (PI_F / 4.0f);
+}
+
+/*
+ * Check a batch of positions against the walls and posts of the cells
+ * they are in. Returns the index of the first one that hits or -1.
+ */
+static int collideBatch(const maze_t *maze, const mouseModel_t *mouse, const float *x, const float *y, int n) {
+  const float cell = mouse->cellSize;
+  const float scale = 1.0f / mouse->cellSize;
+  const float size = cell * MAZE_WIDTH;
+  const float wall = mouse->wallThickness * 0.5f;
+  const float r = mouse->radius;
+  uint8_t hit[DRIVE_BATCH];
+  int i;
+  for (i = 0; i < n; i++) {
+    int outside = (x[i] < 0.0f) | (y[i] < 0.0f) | (x[i] >= size) | (y[i] >= size);
+    int cx = outside ? 0 : (int) (x[i] * scale);
+    int cy = outside ? 0 : (int) (y[i] * scale);
+    float u = x[i] - cx * cell;
+    float v = y[i] - cy * cell;
+    int walls = maze->cells[CELL(cx, cy)];
+    float px = (u < cell - u ? u : cell - u) - wall;
+    float py = (v < cell - v ? v : cell - v) - wall;
+    px = px > 0.0f ? px : 0.0f;
+    py = py > 0.0f ? py : 0.0f;
+    hit[i] = outside
+            | ((walls >> NORTH) & (v + r > cell - wall))
+            | ((walls >> EAST) & (u + r > cell - wall))
+            | ((walls >> SOUTH) & (v - r < wall))
+            | ((walls >> WEST) & (u - r < wall))
+            | (px * px + py * py < r * r);
+  }
+  for (i = 0; i < n; i++) {
+    if (hit[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Check and record the samples collected so far.
+ * Returns 0 or -1 if the mouse hit something.
+ */
+static int flushSamples(sampler_t *s) {
+  int hit = -1;
+  int i;
+  if (s->maze) {
+    hit = collideBatch(s->maze, s->mouse, s->x, s->y, s->n);
+  }
+  for (i = 0; i < s->n && (hit < 0 || i <= hit); i++) {
+    int k = s->result->samples++;
+    if (k < s->traceSize) {
+      s->trace[k].x = s->x[i];
+      s->trace[k].y = s->y[i];
+      s->trace[k].heading = s->heading[i];
+      s->trace[k].command = s->command[i];
+    }
+  }
+  s->n = 0;
+  if (hit >= 0) {
+    s->result->status = DRIVE_COLLISION;
+    s->result->command = s->command[hit];
+    s->result->x = s->x[hit];
+    s->result->y = s->y[hit];
+    return -1;
+  }
+  return 0;
+}
+
+static int addSample(sampler_t *s, float x, float y, float heading, int command) {
+  s->x[s->n] = x;
+  s->y[s->n] = y;
+  s->heading[s->n] = heading;
+  s->command[s->n] = (uint8_t) command;
+  if (++s->n == DRIVE_BATCH) {
+    return flushSamples(s);
+  }
+  return 0;
+}
+
+/*
+ * Sample a straight from (x,y) for length mm.
+ */
+static int sampleStraight(sampler_t *s, float x, float y, int heading, float length, int command) {
+  float dx = unitX(heading);
+  float dy = unitY(heading);
+  int count = (int) ceilf(length / s->mouse->sampleStep);
+  int j;
+  for (j = 1; j <= count; j++) {
+    float d = length * j / count;
+    if (addSample(s, x + dx * d, y + dy * d, headingAngle(heading), command) != 0) {
+      return -1;
+    }
+  }
+  s->result->length += length;
+  return 0;
+}
+
+/*
+ * Sample the arc that rounds off a corner. It starts one tangent length
+ * before the corner on the entry line and ends one tangent length after
+ * it on the exit line.
+ */
+static int sampleArc(sampler_t *s, const corner_t *c) {
+  float dx = unitX(c->headingIn);
+  float dy = unitY(c->headingIn);
+  float side = c->turn > 0 ? 1.0f : -1.0f;
+  float nx = side * dy;
+  float ny = -side * dx;
+  float cx = c->x - dx * c->tangent + nx * c->radius;
+  float cy = c->y - dy * c->tangent + ny * c->radius;
+  float angle = abs(c->turn) * (PI_F / 4.0f);
+  float length = c->radius * angle;
+  int count = (int) ceilf(length / s->mouse->sampleStep);
+  float step = angle / count;
+  float cosStep = cosf(step);
+  float sinStep = sinf(step);
+  float cosPhi = 1.0f;
+  float sinPhi = 0.0f;
+  int j;
+  for (j = 1; j <= count; j++) {
+    float t = cosPhi * cosStep - sinPhi * sinStep;
+    float x;
+    float y;
+    sinPhi = sinPhi * cosStep + cosPhi * sinStep;
+    cosPhi = t;
+    x = cx + c->radius * (dx * sinPhi - nx * cosPhi);
+    y = cy + c->radius * (dy * sinPhi - ny * cosPhi);
+    if (addSample(s, x, y, headingAngle(c->headingIn) + side * step * j, c->command) != 0) {
+      return -1;
+    }
+  }
+  s->result->length += length;
+  return 0;
+}
+
+static void setCorner(corner_t *c, float x, float y, int turn, float radius, int headingIn, int command) {
+  c->x = x;
+  c->y = y;
+  c->turn = (int8_t) turn;
+  c->radius = radius;
+  c->tangent = radius > 0.0f ? radius * tanf(abs(turn) * (PI_F / 8.0f)) : 0.0f;
+  c->headingIn = (uint8_t) headingIn;
+  c->headingOut = (uint8_t) ((headingIn + turn) & 7);
+  c->command = (uint8_t) command;
+}
+
+/*
+ * Add the corners for one turn from pose a to pose b. Returns the
+ * number of corners added.
+ */
+static int addTurn(corner_t *c, const pose_t *a, const pose_t *b, COMMAND cmd, int command, const mouseModel_t *mouse) {
+  const turnGeometry_t *g = &turnGeometry[cmd - IP45R];
+  float half = mouse->cellSize * 0.5f;
+  float radius = mouse->turnRadius[cmd - IP45R];
+  float ax = (a->x + 1) * half;
+  float ay = (a->y + 1) * half;
+  float bx = (b->x + 1) * half;
+  float by = (b->y + 1) * half;
+  float d1x = unitX(a->heading);
+  float d1y = unitY(a->heading);
+  float d2x = unitX(b->heading);
+  float d2y = unitY(b->heading);
+  float cross;
+  float s;
+  if (cmd <= IP180L) {
+    setCorner(c, ax, ay, g->turn, 0.0f, a->heading, command);
+    return 1;
+  }
+  if (cmd == SS180R || cmd == SS180L) {
+    setCorner(&c[0], ax, ay, g->turn / 2, radius, a->heading, command);
+    setCorner(&c[1], bx, by, g->turn / 2, radius, c[0].headingOut, command);
+    return 2;
+  }
+  cross = d1x * d2y - d1y * d2x;
+  s = ((bx - ax) * d2y - (by - ay) * d2x) / cross;
+  setCorner(c, ax + d1x * s, ay + d1y * s, g->turn, radius, a->heading, command);
+  return 1;
+}
+
+/*
+ * Drive a CMD_STOP terminated list from the start cell heading north.
+ *
+ * The maze may be NULL to build the path and check that every turn fits
+ * without looking for collisions. Up to traceSize samples of the path
+ * are written to trace if it is not NULL, which is useful for drawing
+ * the path or checking it in detail. It keeps no state between calls so
+ * several threads can check paths at once.
+ *
+ * Returns the status, which is also in the result.
+ */
+int driveList(const maze_t *maze, const COMMAND *list, const mouseModel_t *mouse,
+        tracePoint_t *trace, int traceSize, driveResult_t *result) {
+  corner_t corners[MAX_CORNERS];   // about 10KB of stack
+  sampler_t sampler;
+  pose_t pose;
+  int n = 1;
+  int i;
+  result->status = DRIVE_OK;
+  result->command = -1;
+  result->length = 0.0f;
+  result->samples = 0;
+  poseStart(&pose);
+  setCorner(&corners[0], mouse->cellSize * 0.5f, mouse->cellSize * 0.5f, 0, 0.0f, 0, 0);
+  for (i = 0; i < COMMAND_LIST_SIZE && list[i] != CMD_STOP; i++) {
+    COMMAND parts[INTEGRATED_PARTS];
+    int count = integratedParts(list[i], parts);
+    int k;
+    if (count == 0) {
+      parts[0] = list[i];
+      count = 1;
+    }
+    /* an integrated turn follows the same corners as its parts */
+    for (k = 0; k < count; k++) {
+      pose_t before = pose;
+      if (poseApply(&pose, parts[k]) != 0) {
+        result->status = DRIVE_BAD_COMMAND;
+        result->command = i;
+        return result->status;
+      }
+      if (parts[k] >= CMD_TURN) {
+        n += addTurn(&corners[n], &before, &pose, parts[k], i, mouse);
+      }
+    }
+  }
+  result->end = pose;
+  setCorner(&corners[n++], (pose.x + 1) * mouse->cellSize * 0.5f, (pose.y + 1) * mouse->cellSize * 0.5f, 0, 0.0f, pose.heading, i > 0 ? i - 1 : 0);
+
+  /* every arc must fit between the corners either side of it */
+  for (i = 0; i + 1 < n; i++) {
+    const corner_t *c = &corners[i];
+    float along = (corners[i + 1].x - c->x) * unitX(c->headingOut) + (corners[i + 1].y - c->y) * unitY(c->headingOut);
+    if (along + 0.01f < c->tangent + corners[i + 1].tangent) {
+      result->status = DRIVE_NO_ROOM;
+      result->command = corners[i + 1].command;
+      result->x = corners[i + 1].x;
+      result->y = corners[i + 1].y;
+      return result->status;
+    }
+  }
+
+  sampler.maze = maze;
+  sampler.mouse = mouse;
+  sampler.trace = trace;
+  sampler.traceSize = trace ? traceSize : 0;
+  sampler.result = result;
+  sampler.n = 0;
+  if (addSample(&sampler, corners[0].x, corners[0].y, 0.0f, 0) != 0) {
+    return result->status;
+  }
+  for (i = 0; i + 1 < n; i++) {
+    const corner_t *c = &corners[i];
+    const corner_t *next = &corners[i + 1];
+    float along = (next->x - c->x) * unitX(c->headingOut) + (next->y - c->y) * unitY(c->headingOut);
+    if (c->radius > 0.0f && sampleArc(&sampler, c) != 0) {
+      return result->status;
+    }
+    if (sampleStraight(&sampler, c->x + unitX(c->headingOut) * c->tangent, c->y + unitY(c->headingOut) * c->tangent,
+            c->headingOut, along - c->tangent - next->tangent, next->command) != 0) {
+      return result->status;
+    }
+  }
+  flushSamples(&sampler);
+  return result->status;
+}
@@ -0,0 +1,94 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef DRIVE_H
+#define	DRIVE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+#include "maze.h"
+#include "pose.h"
+
+  /*
+   * Drive a command list through a maze as a real mouse would.
+   *
+   * The path is built from the nominal poses in pose.c. Every turn has a
+   * corner where its entry and exit lines cross and the corner is rounded
+   * off with an arc of the turn radius for that command. SS180 has two
+   * 90 degree corners, one in each cell it turns in, and the in-place
+   * turns have a corner with no radius. The arcs must fit on the straights
+   * either side of them or the list cannot be driven as written.
+   *
+   * The mouse is a disc of the given radius. It is checked every
+   * sampleStep mm against the walls and posts of the cell it is in, which
+   * is enough since the walls of any other cell are further away than the
+   * posts of this one. Positions are in mm from the south west corner of
+   * the maze with the start cell centre at (cellSize/2, cellSize/2).
+   */
+
+#define DRIVE_OK          (0)
+#define DRIVE_BAD_COMMAND (1)  // an error or a command for the wrong heading
+#define DRIVE_NO_ROOM     (2)  // a turn does not fit on the straights around it
+#define DRIVE_COLLISION   (3)  // the mouse hits a wall or post or leaves the maze
+
+#define DRIVE_BATCH       (64)
+
+  typedef struct {
+    float cellSize;
+    float wallThickness;
+    float radius;           // half the width of the mouse
+    float sampleStep;
+    float turnRadius[TURN_COUNT];
+  } mouseModel_t;
+
+  typedef struct {
+    float x;
+    float y;
+    float heading;          // radians clockwise from north
+    uint8_t command;        // index of the command being driven
+  } tracePoint_t;
+
+  typedef struct {
+    int status;
+    int command;            // index of the command that failed
+    float x;                // where it failed
+    float y;
+    float length;           // of the path up to the end or the failure
+    int samples;
+    pose_t end;             // nominal pose at the end of the list
+  } driveResult_t;
+
+  extern const mouseModel_t defaultMouseModel;
+
+  int driveList(const maze_t *maze, const COMMAND *list, const mouseModel_t *mouse,
+          tracePoint_t *trace, int traceSize, driveResult_t *result);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DRIVE_H */
@@ -0,0 +1,192 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "commands.h"
+#include "makepath.h"
+#include "planner.h"
+#include "explore.h"
+#include "speculate.h"
+
+/*
+ * A deterministic search simulator. A virtual mouse starts in the start
+ * cell facing north and only knows what the rules guarantee about the
+ * maze. In every cell it reads the left, front and right walls from the
+ * real maze, plans the best route to the goal with what it knows, turns
+ * that route into a diagonal path and then moves one cell along it.
+ *
+ * The time taken to plan and to generate the path is recorded for every
+ * cell so that the worst case can be checked against the time the
+ * mouse has to decide before it reaches the next cell.
+ *
+ * With speculation the route for the next cell is planned on a second
+ * thread for every way its walls could turn out while the mouse is
+ * still deciding how to get there. The simulator gives that thread at
+ * most driveNs, the time the mouse would spend driving into the cell,
+ * then takes the decision from the speculation if it can and only plans
+ * when it cannot. A speculation that is not ready by then is late and
+ * counts as a miss even if it arrives during the planning. Only the
+ * lookup or the planning counts as decision time.
+ *
+ * With a transposition table the known walls are hashed as they are
+ * seen, and a state that was planned before takes its route and command
+ * list from the table with no planning and no call to makeDiagonalPath().
+ * The table is owned by the caller so it can carry results from one
+ * maze to the next.
+ *
+ * The results are accumulated so one result can cover many mazes.
+ */
+
+void exploreResultClear(exploreResult_t *result) {
+  memset(result, 0, sizeof (*result));
+}
+
+/*
+ * Returns 0 if the goal was reached, -1 otherwise.
+ */
+int exploreMaze(const maze_t *truth, const exploreConfig_t *config, exploreResult_t *result) {
+  static maze_t known;
+  static planner_t planner;
+  static uint16_t dist[MAZE_CELLS];
+  uint8_t visited[MAZE_CELLS];
+  char route[MAX_ROUTE];
+  int cell = START_CELL;
+  int heading = NORTH;
+  int steps = 0;
+  uint64_t walls;
+  speculator_t *spec = NULL;
+  if (config->speculateDepth > 0) {
+    spec = malloc(sizeof (*spec));
+    if (spec == NULL || specInit(spec, config->speculateDepth, config->speculateMemory) != 0) {
+      free(spec);
+      return -1;
+    }
+  }
+  mazeInitExplore(&known);
+  walls = zobristMaze(&known);
+  memset(visited, 0, sizeof (visited));
+  visited[cell] = 1;
+  result->cellsVisited++;
+  if (config->incremental) {
+    plannerInit(&planner, &known, cell);
+    planner.budget = config->budget;
+  }
+  while (!mazeIsGoal(cell) && steps < 4 * MAZE_CELLS) {
+    const uint16_t *d = dist;
+    uint64_t t0;
+    uint64_t t1;
+    uint64_t t2;
+    const specNode_t *hit = NULL;
+    const transEntry_t *entry = NULL;
+    int late = 0;
+    uint64_t key = 0;
+    int expansions = 0;
+    int i;
+    for (i = 0; i < 4; i++) {
+      int h = (heading + i) & 3;
+      if (i != 2 && !mazeIsKnown(&known, cell, h)) {
+        int wall = mazeHasWall(truth, cell, h);
+        walls = zobristSetWall(walls, &known, cell, h, wall);
+        mazeSetWall(&known, cell, h, wall);
+        if (config->incremental && wall) {
+          plannerWallChanged(&planner, cell, h);
+        }
+      }
+    }
+    if (spec != NULL && specWait(spec, config->driveNs) != 0) {
+      late = 1;
+      result->speculateLate++;
+    }
+    t0 = nowNs();
+    if (spec != NULL && !late && (hit = specLookup(spec, &known, cell, heading)) != NULL) {
+      heading = hit->nextHeading;
+      t1 = t2 = nowNs();
+      result->speculateHits++;
+    } else if (config->table != NULL
+            && (entry = transLookup(config->table, key = walls ^ zobristPosition(cell, heading))) != NULL) {
+      heading = entry->nextHeading;
+      t1 = t2 = nowNs();
+      result->tableHits++;
+      result->tableHitNs += t2 - t0;
+    } else {
+      if (config->incremental) {
+        while (plannerUpdate(&planner) == PLAN_INCOMPLETE) {
+          expansions += planner.expansions;
+        }
+        expansions += planner.expansions;
+        d = planner.g;
+      } else {
+        expansions = floodMaze(&known, dist);
+      }
+      if (makeRoute(&known, d, cell, heading, route, &heading) < 0) {
+        break;
+      }
+      t1 = nowNs();
+      makeDiagonalPath(route);
+      t2 = nowNs();
+      result->speculateMisses += spec != NULL;
+      if (config->table != NULL) {
+        transStore(config->table, key, route, heading, commandList, commandCount());
+        result->tableMisses++;
+        result->tableMissNs += t2 - t0;
+      }
+    }
+    histRecord(&result->solve, t1 - t0);
+    histRecord(&result->generate, t2 - t1);
+    histRecord(&result->step, t2 - t0);
+    result->expansions += expansions;
+    if (expansions > result->maxExpansions) {
+      result->maxExpansions = expansions;
+    }
+    if (config->deadlineNs && t2 - t0 > config->deadlineNs) {
+      result->deadlineMisses++;
+    }
+    cell += mazeDelta[heading];
+    if (!visited[cell]) {
+      visited[cell] = 1;
+      result->cellsVisited++;
+    }
+    if (config->incremental) {
+      plannerMoveTo(&planner, cell);
+    }
+    if (spec != NULL && !mazeIsGoal(cell)) {
+      specStart(spec, &known, cell, heading, hit);
+    }
+    steps++;
+  }
+  if (spec != NULL) {
+    specFree(spec);
+    result->speculateBuilt += spec->built;
+    result->speculateReused += spec->reused;
+    free(spec);
+  }
+  result->steps += steps;
+  if (!mazeIsGoal(cell)) {
+    return -1;
+  }
+  result->reachedGoal++;
+  floodMaze(&known, dist);
+  result->routeLength = makeRoute(&known, dist, START_CELL, NORTH, result->route, NULL);
+  return 0;
+}
@@ -0,0 +1,79 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef EXPLORE_H
+#define	EXPLORE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "maze.h"
+#include "flood.h"
+#include "histogram.h"
+#include "transpose.h"
+
+  typedef struct {
+    int incremental;       // use the incremental planner rather than a re-flood
+    int budget;            // planner expansions per call, 0 for no limit
+    uint64_t deadlineNs;   // per cell planning deadline, 0 for none
+    int speculateDepth;    // cells planned ahead on a second thread, 0 for none
+    size_t speculateMemory;// cap on the speculation trees in bytes
+    uint64_t driveNs;      // longest wait for the speculation before planning
+    transTable_t *table;   // transposition table kept across calls, NULL for none
+  } exploreConfig_t;
+
+  typedef struct {
+    histogram_t solve;     // plan and build the route
+    histogram_t generate;  // makeDiagonalPath() on that route
+    histogram_t step;      // both together
+    int steps;             // cells moved
+    int cellsVisited;      // distinct cells entered, including the start
+    int deadlineMisses;
+    int speculateHits;     // decisions taken from a speculation
+    int speculateMisses;   // decisions planned when the mouse got there
+    int speculateLate;     // of those, speculations not ready within driveNs
+    long speculateBuilt;   // outcomes planned ahead
+    long speculateReused;  // outcomes carried over from the step before
+    int tableHits;         // decisions taken from the transposition table
+    int tableMisses;       // table lookups that had to plan
+    uint64_t tableHitNs;   // time spent on the decisions taken from the table
+    uint64_t tableMissNs;  // time spent planning and generating after a miss
+    long expansions;       // cells expanded by the planner or flood
+    int maxExpansions;     // worst case in any one cell
+    int reachedGoal;
+    int routeLength;
+    char route[MAX_ROUTE]; // best route from the start once the search ends
+  } exploreResult_t;
+
+  void exploreResultClear(exploreResult_t *result);
+  int exploreMaze(const maze_t *truth, const exploreConfig_t *config, exploreResult_t *result);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EXPLORE_H */
+
@@ -0,0 +1,186 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "commands.h"
+#include "makepath.h"
+#include "histogram.h"
+#include "testdata.h"
+#include "timemodel.h"
+#include "timefit.h"
+
+/*
+ * Fit the time model to recorded runs.
+ *
+ *   diagonal-fit [options] [log files]
+ *   diagonal-fit -g count [-s seed] [-b]
+ *
+ * options:
+ *   -b         logs are binary rather than CSV
+ *   -p file    start from this model rather than defaultTimeModel
+ *   -w weight  how strongly to hold parameters to the prior (default 1)
+ *   -t         write parameter lines for timeModelRead() rather than C
+ *   -n name    name of the C initialiser (default fittedTimeModel)
+ *   -g count   write a synthetic log of count segments instead of fitting
+ *   -s seed    seed for the synthetic log
+ *
+ * Logs are read from the files given, or from stdin. The fitted model
+ * goes to stdout and a summary of the fit to stderr. The synthetic log
+ * is made from random routes split into short segments and timed with a
+ * perturbed copy of the default model plus 2% noise, so a fit of it can
+ * be checked against the model it came from.
+ */
+
+static uint32_t nextRandom(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return *seed >> 8;
+}
+
+static int writeSynthetic(long count, uint32_t seed, int binary) {
+  timeModel_t truth = defaultTimeModel;
+  char route[MAX_CMD_COUNT];
+  int i;
+  for (i = 0; i < FIT_PARAMS; i++) {
+    *timeModelParam(&truth, i) *= 0.8f + 0.4f * (nextRandom(&seed) & 0xFFFF) / 65536.0f;
+  }
+  truth.straightBase = 0.02f;
+  truth.diagonalBase = 0.015f;
+  while (count > 0) {
+    int p = 0;
+    makeRandomRoute(route, 64, &seed);
+    makeDiagonalPath(route);
+    while (commandList[p] != CMD_STOP && count > 0) {
+      int n = 1 + nextRandom(&seed) % 3;
+      double t = 0.0;
+      int j;
+      for (j = 0; j < n && commandList[p + j] != CMD_STOP; j++) {
+        t += commandTime(&truth, commandList[p + j]);
+      }
+      n = j;
+      t *= 1.0 + 0.02 * ((nextRandom(&seed) & 0xFFFF) / 32768.0 - 1.0);
+      if (binary) {
+        uint32_t us = (uint32_t) (t * 1e6 + 0.5);
+        unsigned char bytes[4] = {us, us >> 8, us >> 16, us >> 24};
+        putchar(n);
+        fwrite(commandList + p, 1, n, stdout);
+        fwrite(bytes, 1, sizeof (bytes), stdout);
+      } else {
+        char name[16];
+        printf("%.6f", t);
+        for (j = 0; j < n; j++) {
+          formatCommand(commandList[p + j], name, sizeof (name));
+          printf(",%s", name);
+        }
+        printf("\n");
+      }
+      p += n;
+      count--;
+    }
+  }
+  fprintf(stderr, "true model:\n");
+  timeModelWrite(&truth, stderr, NULL);
+  return EXIT_SUCCESS;
+}
+
+static long readLog(timeFit_t *fit, FILE *in, int binary) {
+  return binary ? fitReadBinary(fit, in) : fitReadCsv(fit, in);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: diagonal-fit [-b] [-p prior] [-w weight] [-t] [-n name] [log files] | diagonal-fit -g count [-s seed] [-b]\n");
+}
+
+int main(int argc, char** argv) {
+  static timeFit_t fit;
+  timeModel_t prior = defaultTimeModel;
+  timeModel_t model;
+  const char *name = "fittedTimeModel";
+  uint32_t seed = 1;
+  long synthetic = 0;
+  double weight = 1.0;
+  double rms;
+  uint64_t start;
+  int binary = 0;
+  int text = 0;
+  int i;
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-b") == 0) {
+      binary = 1;
+    } else if (strcmp(argv[i], "-t") == 0) {
+      text = 1;
+    } else if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+      weight = atof(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+      name = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+      synthetic = atol(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+      seed = strtoul(argv[++i], NULL, 0);
+    } else if (i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+      FILE *in = fopen(argv[++i], "r");
+      if (in == NULL || timeModelRead(&prior, in) < 0) {
+        fprintf(stderr, "could not read the model in %s\n", argv[i]);
+        return EXIT_FAILURE;
+      }
+      fclose(in);
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (synthetic > 0) {
+    return writeSynthetic(synthetic, seed, binary);
+  }
+  start = nowNs();
+  fitClear(&fit);
+  if (i == argc) {
+    readLog(&fit, stdin, binary);
+  }
+  for (; i < argc; i++) {
+    FILE *in = fopen(argv[i], binary ? "rb" : "r");
+    if (in == NULL) {
+      fprintf(stderr, "could not read %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    readLog(&fit, in, binary);
+    fclose(in);
+  }
+  if (fitSolve(&fit, &prior, weight, &model, &rms) != 0) {
+    fprintf(stderr, "nothing to fit: %ld segments, %ld rejected\n", fit.segments, fit.rejected);
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "%ld segments fitted in %.3f s, %ld rejected, rms residual %.2f ms\n", fit.segments,
+          (nowNs() - start) * 1e-9, fit.rejected, rms * 1e3);
+  for (i = 0; i < FIT_PARAMS; i++) {
+    char param[32];
+    if (fit.uses[i] == 0) {
+      fprintf(stderr, "  %s not in the log, prior kept\n", timeModelParamName(i, param, sizeof (param)));
+    }
+  }
+  timeModelWrite(&model, stdout, text ? NULL : name);
+  return EXIT_SUCCESS;
+}
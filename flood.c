@@ -0,0 +1,120 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include "flood.h"
+
+/*
+ * A breadth first flood of the maze from the goal. Every cell gets the
+ * number of cells that must be crossed to reach the goal. Walls that
+ * have not been seen are treated as absent. Cells that cannot reach the
+ * goal are left at DIST_INF.
+ *
+ * This is the full re-flood that the explorer would do after every new
+ * wall. It is kept as the reference against which the incremental
+ * planner is checked and timed.
+ *
+ * Returns the number of cells that were expanded.
+ */
+int floodMaze(const maze_t *maze, uint16_t *dist) {
+  uint8_t queue[MAZE_CELLS];
+  int head = 0;
+  int tail = 0;
+  int cell;
+  for (cell = 0; cell < MAZE_CELLS; cell++) {
+    dist[cell] = DIST_INF;
+    if (mazeIsGoal(cell)) {
+      dist[cell] = 0;
+      queue[tail++] = cell;
+    }
+  }
+  while (head < tail) {
+    int h;
+    cell = queue[head++];
+    for (h = 0; h < 4; h++) {
+      // boundary walls are always set so there is no need to range check
+      if (!mazeHasWall(maze, cell, h)) {
+        int next = cell + mazeDelta[h];
+        if (dist[next] == DIST_INF) {
+          dist[next] = dist[cell] + 1;
+          queue[tail++] = next;
+        }
+      }
+    }
+  }
+  return tail;
+}
+
+/*
+ * Turn a distance map into a route string that makeDiagonalPath() will
+ * accept. There is one character for every cell on the route:
+ *   F : the mouse goes straight through this cell
+ *   R : the mouse turns right in this cell
+ *   L : the mouse turns left in this cell
+ *   S : the goal. The mouse stops here.
+ *
+ * Paths cannot start with a turn so the route always starts with the
+ * mouse leaving the given cell in the direction of its first move. That
+ * direction is returned in firstHeading so that an explorer can turn
+ * to face it. Ties are broken in favour of going straight on.
+ *
+ * Works with any distance map where the best neighbour has the lowest
+ * value, so it can be used with either the flood or the planner.
+ *
+ * Returns the length of the route or -1 if the goal cannot be reached
+ * or the route does not fit in MAX_ROUTE characters.
+ */
+int makeRoute(const maze_t *maze, const uint16_t *dist, int cell, int heading, char *route, int *firstHeading) {
+  static const char turnChar[4] = {'F', 'R', 'X', 'L'};
+  int length = 0;
+  if (dist[cell] == DIST_INF) {
+    return -1;
+  }
+  while (dist[cell] != 0) {
+    int best = -1;
+    uint16_t bestDist = dist[cell];
+    int i;
+    for (i = 0; i < 4; i++) {
+      int h = (heading + (i == 3 ? 2 : i == 2 ? 3 : i)) & 3;
+      if (!mazeHasWall(maze, cell, h) && dist[cell + mazeDelta[h]] < bestDist) {
+        best = h;
+        bestDist = dist[cell + mazeDelta[h]];
+      }
+    }
+    if (best < 0 || length >= MAX_ROUTE - 2) {
+      return -1;
+    }
+    if (length == 0) {
+      if (firstHeading) {
+        *firstHeading = best;
+      }
+      route[length++] = 'F';
+    } else {
+      route[length++] = turnChar[(best - heading) & 3];
+    }
+    heading = best;
+    cell += mazeDelta[best];
+  }
+  route[length++] = 'S';
+  route[length] = 0;
+  return length;
+}
@@ -0,0 +1,142 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "histogram.h"
+#include "makepath.h"
+#include "route.h"
+#include "stride.h"
+#include "generator.h"
+
+/*
+ * The packed generator works from a packed route, so the route is packed
+ * first and the time taken includes the packing. A route with a
+ * character that cannot be packed has no packed path: the list is left
+ * empty and packedAccepts() keeps such routes out of comparisons.
+ */
+static void makeDiagonalPathFromPacked(const char *route) {
+  packedRoute_t packed;
+  if (routePack(&packed, route) != -1) {
+    clearCommands();
+    return;
+  }
+  makeDiagonalPathPacked(&packed);
+}
+
+static int packedAccepts(const char *route) {
+  packedRoute_t packed;
+  return routePack(&packed, route) == -1 ? 0 : -1;
+}
+
+static int strideReady(void) {
+  return strideInit() == 0 && strideVerify() == 0 ? 0 : -1;
+}
+
+static const generator_t generators[] = {
+  {"reference", "switch machine, one character per step", NULL, makeDiagonalPath, NULL},
+  {"stride", "table driven, several characters per lookup", strideReady, makeDiagonalPathStride, NULL},
+  {"packed", "two bits per move, packed on the fly", NULL, makeDiagonalPathFromPacked, packedAccepts},
+};
+
+int generatorCount(void) {
+  return sizeof (generators) / sizeof (generators[0]);
+}
+
+const generator_t *generatorAt(int index) {
+  return index >= 0 && index < generatorCount() ? &generators[index] : NULL;
+}
+
+const generator_t *findGenerator(const char *name) {
+  int i;
+  for (i = 0; i < generatorCount(); i++) {
+    if (strcmp(generators[i].name, name) == 0) {
+      return &generators[i];
+    }
+  }
+  return NULL;
+}
+
+int generatorInit(const generator_t *generator) {
+  return generator->init != NULL ? generator->init() : 0;
+}
+
+int generatorAccepts(const generator_t *generator, const char *route) {
+  return generator->accepts != NULL ? generator->accepts(route) : 0;
+}
+
+/*
+ * Run every route through both generators and compare the lists, then
+ * time each generator over all the routes, passes times over. Routes
+ * either generator cannot take are counted as skipped and left out of
+ * the comparison and the timing. Returns 0 if every list compared
+ * matched, -1 if not or if either generator would not initialise.
+ */
+int compareGenerators(const generator_t *a, const generator_t *b, const char *const *routes, int count, int passes,
+                      generatorComparison_t *result) {
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  const generator_t *pair[2] = {a, b};
+  const char **kept;
+  int n = 0;
+  int pass;
+  int g;
+  int i;
+  memset(result, 0, sizeof (*result));
+  result->firstMismatch = -1;
+  if (generatorInit(a) != 0 || generatorInit(b) != 0) {
+    return -1;
+  }
+  kept = malloc((size_t) (count > 0 ? count : 1) * sizeof (*kept));
+  if (kept == NULL) {
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    if (generatorAccepts(a, routes[i]) != 0 || generatorAccepts(b, routes[i]) != 0) {
+      result->skipped++;
+      continue;
+    }
+    kept[n++] = routes[i];
+    a->generate(routes[i]);
+    memcpy(expected, commandList, sizeof (expected));
+    b->generate(routes[i]);
+    if (compareCommands(expected, commandList, COMMAND_LIST_SIZE) != -1) {
+      if (result->firstMismatch < 0) {
+        result->firstMismatch = i;
+      }
+      result->mismatches++;
+    }
+    result->characters += strlen(routes[i]);
+  }
+  result->routes = n;
+  for (pass = 0; pass < passes; pass++) {
+    for (g = 0; g < 2; g++) {
+      uint64_t start = nowNs();
+      for (i = 0; i < n; i++) {
+        pair[g]->generate(kept[i]);
+      }
+      result->elapsed[g] += nowNs() - start;
+    }
+  }
+  free(kept);
+  return result->mismatches == 0 ? 0 : -1;
+}
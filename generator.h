@@ -0,0 +1,78 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef GENERATOR_H
+#define	GENERATOR_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+
+  /*
+   * Every form of the path generator behind one interface, so that a new
+   * or faster one can be run over the same routes as the reference and
+   * checked against it before it is trusted. A generator takes a route
+   * string and leaves the terminated command list in commandList. One
+   * that cannot take every route says which it can with accepts(); the
+   * others are left out of a comparison and counted on their own rather
+   * than handed to some other generator.
+   *
+   * To add a generator, add an entry to the table in generator.c. The
+   * first entry is the reference switch machine in makepath.c that the
+   * others are compared with.
+   */
+
+  typedef struct {
+    const char *name;
+    const char *description;
+    int (*init)(void);                  // 0 if ready, NULL if nothing to do
+    void (*generate)(const char *route);
+    int (*accepts)(const char *route);  // 0 if generate() can take the route, NULL for any
+  } generator_t;
+
+  typedef struct {
+    long routes;
+    long characters;
+    long mismatches;       // routes where the two lists differ
+    long skipped;          // routes one of the generators cannot take
+    int firstMismatch;     // route index of the first, or -1
+    uint64_t elapsed[2];   // ns spent in each generator over all passes
+  } generatorComparison_t;
+
+  int generatorCount(void);
+  const generator_t *generatorAt(int index);
+  const generator_t *findGenerator(const char *name);
+  int generatorInit(const generator_t *generator);
+  int generatorAccepts(const generator_t *generator, const char *route);
+  int compareGenerators(const generator_t *a, const generator_t *b, const char *const *routes, int count, int passes,
+                        generatorComparison_t *result);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* GENERATOR_H */
+
@@ -0,0 +1,93 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "histogram.h"
+
+void histClear(histogram_t *hist) {
+  memset(hist, 0, sizeof (*hist));
+}
+
+static int bucketOf(uint64_t value) {
+  int e;
+  if (value < 8) {
+    return (int) value;
+  }
+  e = 63 - __builtin_clzll(value);
+  return (e - 2) * 8 + (int) ((value >> (e - 3)) & 7);
+}
+
+static uint64_t bucketStart(int bucket) {
+  int e;
+  if (bucket < 8) {
+    return bucket;
+  }
+  e = bucket / 8 + 2;
+  return (uint64_t) (8 + (bucket & 7)) << (e - 3);
+}
+
+void histRecord(histogram_t *hist, uint64_t value) {
+  int b = bucketOf(value);
+  hist->counts[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+  hist->n++;
+  hist->total += value;
+  if (value > hist->max) {
+    hist->max = value;
+  }
+}
+
+void histMerge(histogram_t *into, const histogram_t *from) {
+  int i;
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    into->counts[i] += from->counts[i];
+  }
+  into->n += from->n;
+  into->total += from->total;
+  if (from->max > into->max) {
+    into->max = from->max;
+  }
+}
+
+/*
+ * Returns the start of the bucket holding the given percentile. The
+ * 100th percentile is the exact maximum.
+ */
+uint64_t histPercentile(const histogram_t *hist, double percent) {
+  uint64_t rank;
+  uint64_t seen = 0;
+  int i;
+  if (hist->n == 0) {
+    return 0;
+  }
+  if (percent >= 100.0) {
+    return hist->max;
+  }
+  rank = (uint64_t) (percent / 100.0 * hist->n);
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->counts[i];
+    if (seen > rank) {
+      return bucketStart(i);
+    }
+  }
+  return hist->max;
+}
@@ -0,0 +1,70 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef HISTOGRAM_H
+#define	HISTOGRAM_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+  /*
+   * A fixed size latency histogram. Values below 8 get a bucket each and
+   * above that every power of two is split into eight buckets so that
+   * any percentile is reported to within 12.5% with no allocation and a
+   * constant time record.
+   */
+
+#define HIST_BUCKETS (8 * 62)
+
+  typedef struct {
+    uint32_t counts[HIST_BUCKETS];
+    uint32_t n;
+    uint64_t total;
+    uint64_t max;
+  } histogram_t;
+
+  void histClear(histogram_t *hist);
+  void histRecord(histogram_t *hist, uint64_t value);
+  void histMerge(histogram_t *into, const histogram_t *from);
+  uint64_t histPercentile(const histogram_t *hist, double percent);
+
+  /*
+   * Host timing for the benchmarks. Not used by anything that has to run
+   * on the mouse.
+   */
+  static inline uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+  }
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HISTOGRAM_H */
+
@@ -25,10 +25,41 @@ THE SOFTWARE.
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "commands.h"
 #include "testdata.h"
 #include "makepath.h"
+#include "maze.h"
+#include "flood.h"
+#include "planner.h"
+#include "explore.h"
+#include "pose.h"
+#include "timemodel.h"
+#include "peephole.h"
+#include "speedplan.h"
+#include "codec.h"
+#include "drive.h"
+#include "decompile.h"
+#include "stride.h"
+#include "route.h"
+#include "queue.h"
+#include "arena.h"
+#include "speculate.h"
+#include "trace.h"
+#include "timefit.h"
+#include "generator.h"
+#include "cmdqueue.h"
+#include "strategy.h"
+#include "transpose.h"
+
+#define PLANNER_TEST_COUNT 20
+#define EXPLORE_TEST_COUNT 10
+#define SPECULATE_TIGHT_MEMORY 1000
+#define RANDOM_ROUTE_COUNT 10000
+#define DRIVE_MAZE_COUNT 200
+#define DRIVE_TRACE_SIZE 16384
 
 /*
  * Display the expected and generated command lists side by side in numeric form.
@@ -51,6 +82,20 @@ static void listComparison(COMMAND *pExpected, COMMAND *pActual, size_t n) {
 }
 
 
+/*
+ * The number of error commands in a CMD_STOP terminated list.
+ */
+static int countErrors(const COMMAND *list) {
+  int errors = 0;
+  int i;
+  for (i = 0; i < MAX_CMD_COUNT && list[i] != CMD_STOP; i++) {
+    if (list[i] >= CMD_ERROR_00) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
 /*
  * for each test pair in the test data list, use the input data to generate a
  * set of commands for the output path.
@@ -61,13 +106,19 @@ static void listComparison(COMMAND *pExpected, COMMAND *pActual, size_t n) {
  * values is shown.
  * The test does not stop when it encounters a failure since the same code error
  * may affect several test.
+ * Routes the generator cannot take, such as ones the packed generator
+ * cannot pack, are shown as skipped.
  */
-static int runTestsDiagonal(void) {
+static int runTestsDiagonal(const generator_t *generator) {
   int errorPos;
   int failCount = 0;
   int test;
   for (test = 0; test < testCountDiagonal(); test++) {
-    makeDiagonalPath(testPairsDiagonal[test].input);
+    if (generatorAccepts(generator, testPairsDiagonal[test].input) != 0) {
+      printf("test %3d : SKIP  %-8s  => not accepted by %s\n", test, testPairsDiagonal[test].input, generator->name);
+      continue;
+    }
+    generator->generate(testPairsDiagonal[test].input);
     errorPos = compareCommands(testPairsDiagonal[test].expected, commandList, MAX_CMD_COUNT);
     printf("test %3d : ", test);
     if (errorPos == -1) {
@@ -83,12 +134,1627 @@ static int runTestsDiagonal(void) {
   return failCount;
 }
 
+/*
+ * Explore a set of generated mazes with the incremental planner and check
+ * that after every cell it agrees with a full flood of the same maze
+ * about the distance to the goal and the length of the route. Odd
+ * numbered mazes are planned with a small expansion budget so that
+ * resuming an interrupted update is checked as well. Each maze is also
+ * written out as text and read back.
+ */
+static int runTestsPlanner(void) {
+  static maze_t truth;
+  static maze_t known;
+  static planner_t planner;
+  static uint16_t dist[MAZE_CELLS];
+  char route[MAX_ROUTE];
+  char text[MAZE_TEXT_SIZE];
+  int failCount = 0;
+  int test;
+  for (test = 0; test < PLANNER_TEST_COUNT; test++) {
+    int cell = START_CELL;
+    int heading = NORTH;
+    int steps = 0;
+    int errors = 0;
+    int h;
+    mazeGenerate(&truth, test);
+    mazeToText(&truth, text);
+    if (mazeLoadText(&known, text) != 0 || memcmp(&known, &truth, sizeof (maze_t)) != 0) {
+      errors++;
+    }
+    mazeInitExplore(&known);
+    plannerInit(&planner, &known, cell);
+    planner.budget = (test & 1) ? 8 : 0;
+    while (!mazeIsGoal(cell) && steps < 4 * MAZE_CELLS) {
+      for (h = 0; h < 4; h++) {
+        if (!mazeIsKnown(&known, cell, h)) {
+          mazeSetWall(&known, cell, h, mazeHasWall(&truth, cell, h));
+          if (mazeHasWall(&truth, cell, h)) {
+            plannerWallChanged(&planner, cell, h);
+          }
+        }
+      }
+      while (plannerUpdate(&planner) == PLAN_INCOMPLETE) {
+      }
+      floodMaze(&known, dist);
+      if (planner.g[cell] != dist[cell]) {
+        errors++;
+      }
+      if (makeRoute(&known, planner.g, cell, heading, route, &heading) != dist[cell] + 1) {
+        errors++;
+        break;
+      }
+      cell += mazeDelta[heading];
+      plannerMoveTo(&planner, cell);
+      steps++;
+    }
+    if (!mazeIsGoal(cell)) {
+      errors++;
+    }
+    if (errors) {
+      failCount++;
+    }
+    printf("planner test %3d : %s  %3d cells explored\n", test, errors ? "FAIL" : " OK ", steps);
+  }
+  return failCount;
+}
+
+/*
+ * Run the search simulator over generated mazes with both planners. Each
+ * search must reach the goal, record one latency sample per cell and
+ * leave a final route that the path generator accepts without error.
+ */
+static int runTestsExplore(void) {
+  static maze_t maze;
+  static exploreResult_t result;
+  exploreConfig_t config = {0};
+  int failCount = 0;
+  int test;
+  for (test = 0; test < EXPLORE_TEST_COUNT; test++) {
+    int errors = 0;
+    mazeGenerate(&maze, 1000 + test);
+    config.incremental = test & 1;
+    exploreResultClear(&result);
+    if (exploreMaze(&maze, &config, &result) != 0) {
+      errors++;
+    }
+    if (result.solve.n != (uint32_t) result.steps || result.generate.n != (uint32_t) result.steps) {
+      errors++;
+    }
+    makeDiagonalPath(result.route);
+    errors += countErrors(commandList);
+    if (errors) {
+      failCount++;
+    }
+    printf("explore test %3d : %s  %3d steps %3d cells  %s\n", test, errors ? "FAIL" : " OK ",
+           result.steps, result.cellsVisited, result.route);
+  }
+  return failCount;
+}
+
+/*
+ * Speculation must not change the search: with and without it every
+ * maze is explored along the same cells to the same final route. With
+ * room for the whole first level and ample time to drive each cell
+ * every decision after the first comes from a lookup; with a tight
+ * memory cap some are planned instead. With no time to drive a cell a
+ * speculation that is not ready is late and planned for, and is counted
+ * as a miss; the first step has nothing to wait for and is never late.
+ */
+static int runTestsSpeculate(void) {
+  static maze_t maze;
+  static exploreResult_t plain;
+  static exploreResult_t result;
+  exploreConfig_t config = {0};
+  int errors[3] = {0, 0, 0};
+  int misses = 0;
+  int late = 0;
+  int test;
+  for (test = 0; test < EXPLORE_TEST_COUNT; test++) {
+    int run;
+    mazeGenerate(&maze, 2000 + test);
+    config.speculateDepth = 0;
+    exploreResultClear(&plain);
+    exploreMaze(&maze, &config, &plain);
+    for (run = 0; run < 4; run++) {
+      int e = run < 2 ? 0 : run - 1;
+      config.speculateDepth = run == 1 ? 3 : 1;
+      config.speculateMemory = run == 2 ? SPECULATE_TIGHT_MEMORY : 1 << 20;
+      config.driveNs = run < 3 ? 1000000000u : 0;
+      exploreResultClear(&result);
+      exploreMaze(&maze, &config, &result);
+      if (result.steps != plain.steps || result.cellsVisited != plain.cellsVisited ||
+          result.reachedGoal != plain.reachedGoal || strcmp(result.route, plain.route) != 0) {
+        errors[e]++;
+      }
+      if (result.speculateHits + result.speculateMisses != result.steps) {
+        errors[e]++;
+      }
+      if (run < 2 && result.speculateMisses != 1) {
+        errors[e]++;
+      }
+      if (result.speculateLate > (run < 3 ? 0 : result.speculateMisses - 1)) {
+        errors[e]++;
+      }
+      misses += run == 2 ? result.speculateMisses : 0;
+      late += run == 3 ? result.speculateLate : 0;
+    }
+  }
+  errors[1] += misses <= EXPLORE_TEST_COUNT;
+  printf("speculate test hits    : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("speculate test capped  : %s  %d misses\n", errors[1] ? "FAIL" : " OK ", misses);
+  printf("speculate test late    : %s  %d late\n", errors[2] ? "FAIL" : " OK ", late);
+  return (errors[0] != 0) + (errors[1] != 0) + (errors[2] != 0);
+}
+
+/*
+ * A time model for a mouse that is slow on diagonals, so that the rules
+ * which trade diagonals for orthogonal turns have something to do.
+ */
+static float slowDiagonalCost(const void *context, COMMAND cmd) {
+  float t = commandTime(&defaultTimeModel, cmd);
+  (void) context;
+  if ((cmd > CMD_SQUARES && cmd < CMD_TURN) || (cmd >= SD45R && cmd <= DD90L)) {
+    t *= 3.0f;
+  }
+  return t;
+}
+
+/*
+ * Every rewrite must drive the same path. The first test checks that the
+ * pose model agrees with the route for every generated path. Then every
+ * window of three commands is offered to every rule, which covers the
+ * shorter windows as well since rules only look at the start. Where a
+ * rule matches, the window and its replacement are driven from each of
+ * the eight headings and must end in the same pose. Finally whole lists
+ * are optimised with different capabilities and time models and must
+ * end in the same place without getting slower.
+ */
+static int runTestsPeephole(void) {
+  static const unsigned capabilities[4] = {CAP_ALL, CAP_DIAGONAL | CAP_SMOOTH_90, CAP_SMOOTH_90 | CAP_SMOOTH_180, CAP_IN_PLACE};
+  COMMAND alphabet[64];
+  COMMAND list[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  int symbols = 0;
+  int failCount = 0;
+  int errors = 0;
+  int test;
+  int r;
+  int i;
+  uint32_t seed = 1;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    pose_t expected;
+    pose_t actual;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+    }
+    poseStart(&expected);
+    poseStart(&actual);
+    makeDiagonalPath(input);
+    if (poseFollowRoute(&expected, input) != -1 || countErrors(commandList)) {
+      continue;
+    }
+    if (poseRun(&actual, commandList, COMMAND_LIST_SIZE) != -1 || !poseEqual(&expected, &actual)) {
+      errors++;
+    }
+  }
+  printf("peephole test geometry : %s\n", errors ? "FAIL" : " OK ");
+  failCount += errors != 0;
+
+  for (i = 1; i <= 4; i++) {
+    alphabet[symbols++] = FWD0 + i;
+  }
+  for (i = 0; i <= 4; i++) {
+    alphabet[symbols++] = DIA0 + i;
+  }
+  for (i = IP45R; i <= SS90EL; i++) {
+    alphabet[symbols++] = i;
+  }
+  for (i = 0; i < INTEGRATED_COUNT; i++) {
+    alphabet[symbols++] = CMD_INTEGRATED + i;
+  }
+  for (r = 0; r < peepholeRuleCount; r++) {
+    int matches = 0;
+    int window;
+    errors = 0;
+    for (window = 0; window < symbols * symbols * symbols; window++) {
+      COMMAND in[3] = {alphabet[window % symbols], alphabet[window / symbols % symbols], alphabet[window / symbols / symbols]};
+      COMMAND out[PEEPHOLE_MAX_OUT];
+      int outCount;
+      int w;
+      int h;
+      w = peepholeRules[r].match(in, 3, out, &outCount);
+      if (w == 0) {
+        continue;
+      }
+      matches++;
+      for (h = 0; h < 8; h++) {
+        pose_t before = {0, 0, h};
+        pose_t after = {0, 0, h};
+        int k;
+        int valid = 1;
+        for (k = 0; k < w; k++) {
+          valid = valid && poseApply(&before, in[k]) == 0;
+        }
+        if (!valid) {
+          continue;
+        }
+        for (k = 0; k < outCount; k++) {
+          valid = valid && poseApply(&after, out[k]) == 0;
+        }
+        if (!valid || !poseEqual(&before, &after)) {
+          errors++;
+        }
+      }
+    }
+    if (errors || matches == 0) {
+      failCount++;
+    }
+    printf("peephole rule %-16s : %s  %5d windows\n", peepholeRules[r].name, (errors || matches == 0) ? "FAIL" : " OK ", matches);
+  }
+
+  for (i = 0; i < 8; i++) {
+    commandCostFn cost = (i & 1) ? slowDiagonalCost : timeModelCost;
+    int rewrites = 0;
+    errors = 0;
+    seed = 1;
+    for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+      const char *input = route;
+      pose_t expected;
+      pose_t actual;
+      float before;
+      if (test < testCountDiagonal()) {
+        input = testPairsDiagonal[test].input;
+      } else {
+        makeRandomRoute(route, sizeof (route), &seed);
+      }
+      makeDiagonalPath(input);
+      if (countErrors(commandList)) {
+        continue;
+      }
+      memcpy(list, commandList, sizeof (list));
+      poseStart(&expected);
+      poseStart(&actual);
+      poseRun(&expected, list, COMMAND_LIST_SIZE);
+      before = listCost(cost, &defaultTimeModel, list, COMMAND_LIST_SIZE);
+      rewrites += peepholeOptimise(list, capabilities[i / 2], cost, &defaultTimeModel);
+      if (poseRun(&actual, list, COMMAND_LIST_SIZE) != -1 || !poseEqual(&expected, &actual)
+              || listCost(cost, &defaultTimeModel, list, COMMAND_LIST_SIZE) > before) {
+        errors++;
+      }
+    }
+    if (errors) {
+      failCount++;
+    }
+    printf("peephole test caps %02X %s : %s  %5d rewrites\n", capabilities[i / 2], (i & 1) ? "slow diagonal" : "default      ",
+           errors ? "FAIL" : " OK ", rewrites);
+  }
+  return failCount;
+}
+
+/*
+ * Check the speed annotations for every generated path. The mouse must
+ * start and finish at rest, the speed must be continuous from one command
+ * to the next, no turn may be entered faster than its limit and no
+ * straight may need more acceleration or braking than the mouse has.
+ * A single straight must brake half way along.
+ */
+static int runTestsSpeeds(void) {
+  const speedProfile_t *profile = &defaultSpeedProfile;
+  speedInfo_t info[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 2;
+  int errors = 0;
+  int test;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    int n;
+    int i;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+    }
+    makeDiagonalPath(input);
+    n = annotateSpeeds(commandList, info, profile);
+    if (n == 0) {
+      continue;
+    }
+    if (info[0].entrySpeed != 0 || info[n - 1].exitSpeed != 0) {
+      errors++;
+    }
+    for (i = 0; i < n; i++) {
+      COMMAND cmd = commandList[i];
+      float v0 = info[i].entrySpeed;
+      float v1 = info[i].exitSpeed;
+      float length = commandLength(profile, cmd);
+      if (i > 0 && info[i - 1].exitSpeed != info[i].entrySpeed) {
+        errors++;
+      }
+      if (cmd >= CMD_TURN) {
+        if (v0 != v1 || (cmd <= SS90EL && v0 > profile->turnSpeed[cmd - IP45R]) || info[i].brakePoint != 0) {
+          errors++;
+        }
+      } else if (v1 * v1 > v0 * v0 + 2.0f * profile->acceleration * length + 1000.0f
+              || v0 * v0 > v1 * v1 + 2.0f * profile->deceleration * length + 1000.0f
+              || info[i].brakePoint > length + 0.5f) {
+        errors++;
+      }
+    }
+  }
+  makeDiagonalPath("FFFFS");
+  annotateSpeeds(commandList, info, profile);
+  if (info[0].brakePoint != 360) {
+    errors++;
+  }
+  printf("speed test annotations : %s\n", errors ? "FAIL" : " OK ");
+  return errors != 0;
+}
+
+/*
+ * Every whole frame of an encoded list must decode to the same commands.
+ * The stream is checked four ways: intact with every frame size, cut
+ * short after every byte, when only whole frames may be used, with each
+ * byte in turn corrupted and with each frame in turn lost. Whatever is
+ * damaged, what has been decoded must be the list up to the first frame
+ * that went missing and must only be complete if nothing did.
+ */
+static int codecPrefixMatches(const COMMAND *original, int n, const decoder_t *decoder, int frameCommands, int intact) {
+  int count = decoder->count;
+  return (count % frameCommands == 0 || count == n) && count >= intact * frameCommands
+          && memcmp(decoder->out, original, count) == 0 && decoder->out[count] == CMD_STOP
+          && (!decoder->complete || count == n);
+}
+
+/*
+ * The number of whole frames in a stream before byte i.
+ */
+static int codecFramesBefore(const uint8_t *stream, int i) {
+  int frames = 0;
+  int start = 0;
+  while (start + CODEC_FRAME_OVERHEAD + stream[start + 1] <= i) {
+    start += CODEC_FRAME_OVERHEAD + stream[start + 1];
+    frames++;
+  }
+  return frames;
+}
 
+static int runTestsCodec(void) {
+  static COMMAND original[COMMAND_LIST_SIZE];
+  static COMMAND decoded[COMMAND_LIST_SIZE];
+  static uint8_t stream[2048];
+  static uint8_t lost[2048];
+  static decoder_t decoder;
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 3;
+  int errors[4] = {0, 0, 0, 0};
+  int test;
+  int i;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    int frameCommands = 1 + test % CODEC_FRAME_COMMANDS;
+    int length;
+    int n;
+    if (test < testCountDiagonal()) {
+      makeDiagonalPath(testPairsDiagonal[test].input);
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+      makeDiagonalPath(route);
+    }
+    memcpy(original, commandList, sizeof (original));
+    for (n = 0; original[n] != CMD_STOP; n++) {
+    }
+    length = encodeList(original, stream, sizeof (stream), frameCommands);
+    decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+    if (length < 0 || decodeBytes(&decoder, stream, length) != n || !decoder.complete
+        || decoder.badFrames != 0 || memcmp(decoded, original, n + 1) != 0) {
+      errors[0]++;
+      continue;
+    }
+    if (test % 100 != 0) {
+      continue;
+    }
+    frameCommands = 8;
+    length = encodeList(original, stream, sizeof (stream), frameCommands);
+    for (i = 0; i < length; i++) {
+      int intact = codecFramesBefore(stream, i);
+      decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+      decodeBytes(&decoder, stream, i);
+      if (!codecPrefixMatches(original, n, &decoder, frameCommands, intact) || decoder.complete) {
+        errors[1]++;
+      }
+      decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+      stream[i] ^= 0x10;
+      decodeBytes(&decoder, stream, length);
+      stream[i] ^= 0x10;
+      if (!codecPrefixMatches(original, n, &decoder, frameCommands, intact) || decoder.complete) {
+        errors[2]++;
+      }
+    }
+    for (i = 0; i < length; i += CODEC_FRAME_OVERHEAD + stream[i + 1]) {
+      int size = CODEC_FRAME_OVERHEAD + stream[i + 1];
+      int intact = codecFramesBefore(stream, i);
+      memcpy(lost, stream, i);
+      memcpy(lost + i, stream + i + size, length - i - size);
+      decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+      decodeBytes(&decoder, lost, length - size);
+      if (!codecPrefixMatches(original, n, &decoder, frameCommands, intact) || decoder.complete
+          || decoder.count != intact * frameCommands || decoder.gap != (i + size < length)) {
+        errors[3]++;
+      }
+    }
+  }
+  /* a frame whose last command is cut short must never decode, whatever its check byte */
+  for (i = 0; i < 256; i++) {
+    uint8_t truncated[6] = {CODEC_SYNC, 1, 0, 2, 0x0C, (uint8_t) i};
+    decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+    if (decodeBytes(&decoder, truncated, sizeof (truncated)) != 0 || decoder.frames != 0) {
+      errors[2]++;
+    }
+  }
+  printf("codec test round trip  : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("codec test truncation  : %s\n", errors[1] ? "FAIL" : " OK ");
+  printf("codec test corruption  : %s\n", errors[2] ? "FAIL" : " OK ");
+  printf("codec test lost frame  : %s\n", errors[3] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0) + (errors[2] != 0) + (errors[3] != 0);
+}
 
+/*
+ * Drive every generated path. Each must fit its turns, leave an unbroken
+ * trace and finish in the centre of the last cell of its route. Paths
+ * for the shortest route through generated mazes, as generated and after
+ * the peephole pass, must not touch a wall or post. A wider mouse, a
+ * wall across the route and an oversize turn radius must all be caught.
+ */
+static int runTestsDrive(void) {
+  static tracePoint_t trace[DRIVE_TRACE_SIZE];
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  const mouseModel_t *mouse = &defaultMouseModel;
+  mouseModel_t wide = defaultMouseModel;
+  driveResult_t result;
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 4;
+  int errors[3] = {0, 0, 0};
+  int test;
+  int i;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    pose_t end;
+    float goalX;
+    float goalY;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+    }
+    makeDiagonalPath(input);
+    driveList(NULL, commandList, mouse, trace, DRIVE_TRACE_SIZE, &result);
+    if (countErrors(commandList)) {
+      errors[0] += result.status != DRIVE_BAD_COMMAND;
+      continue;
+    }
+    poseStart(&end);
+    poseFollowRoute(&end, input);
+    goalX = (end.x + 1) * mouse->cellSize * 0.5f;
+    goalY = (end.y + 1) * mouse->cellSize * 0.5f;
+    if (result.status != DRIVE_OK || result.samples > DRIVE_TRACE_SIZE
+            || fabsf(trace[result.samples - 1].x - goalX) > 0.5f || fabsf(trace[result.samples - 1].y - goalY) > 0.5f) {
+      errors[0]++;
+      continue;
+    }
+    for (i = 1; i < result.samples; i++) {
+      float dx = trace[i].x - trace[i - 1].x;
+      float dy = trace[i].y - trace[i - 1].y;
+      if (dx * dx + dy * dy > mouse->sampleStep * mouse->sampleStep + 0.1f) {
+        errors[0]++;
+        break;
+      }
+    }
+  }
+  wide.radius = 60.0f;
+  for (test = 0; test < DRIVE_MAZE_COUNT; test++) {
+    int heading;
+    mazeGenerate(&maze, 2000 + test);
+    floodMaze(&maze, dist);
+    makeRoute(&maze, dist, START_CELL, NORTH, route, &heading);
+    makeDiagonalPath(route);
+    if (driveList(&maze, commandList, mouse, NULL, 0, &result) != DRIVE_OK) {
+      errors[1]++;
+    }
+    if (strchr(route, 'L') && driveList(&maze, commandList, &wide, NULL, 0, &result) != DRIVE_COLLISION) {
+      errors[2]++;
+    }
+    peepholeOptimise(commandList, CAP_ALL, timeModelCost, &defaultTimeModel);
+    if (driveList(&maze, commandList, mouse, NULL, 0, &result) != DRIVE_OK) {
+      errors[1]++;
+    }
+  }
+  mazeInitExplore(&maze);
+  mazeSetWall(&maze, CELL(0, 2), NORTH, 1);
+  makeDiagonalPath("FFFFS");
+  if (driveList(&maze, commandList, mouse, NULL, 0, &result) != DRIVE_COLLISION || result.y > 3 * mouse->cellSize) {
+    errors[2]++;
+  }
+  wide = defaultMouseModel;
+  wide.turnRadius[SS90SR - IP45R] = 200.0f;
+  makeDiagonalPath("FRFS");
+  if (driveList(NULL, commandList, &wide, NULL, 0, &result) != DRIVE_NO_ROOM || commandList[result.command] != SS90SR) {
+    errors[2]++;
+  }
+  printf("drive test trace       : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("drive test clearance   : %s\n", errors[1] ? "FAIL" : " OK ");
+  printf("drive test violations  : %s\n", errors[2] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0) + (errors[2] != 0);
+}
+
+/*
+ * Decompiling a generated list must give back the route it came from.
+ * Routes with three turns the same way in a row are generated as if one
+ * of them was missing, so for those the route that comes back need only
+ * generate the same list. Lists that break the rules must be rejected at
+ * the right command, and a list with no CMD_STOP at its last command.
+ */
+static int runTestsDecompile(void) {
+  static const struct {
+    COMMAND list[8];
+    int errorPos;
+  } malformed[] = {
+    {{SS90SR, FWD1, CMD_STOP}, 0},
+    {{FWD1, DIA2, CMD_STOP}, 1},
+    {{FWD1, SD45R, DIA2, FWD1, CMD_STOP}, 3},
+    {{FWD1, SD45R, DIA2, DS45R, FWD1, CMD_STOP}, 3},
+    {{FWD1, SD45R, DIA3, DD90L, DIA2, DS45L, FWD1, CMD_STOP}, 3},
+    {{FWD1, SS90SR, SS90SR, FWD1, CMD_STOP}, 2},
+    {{FWD1, SS90SR, CMD_STOP}, 2},
+    {{FWD1, IP180R, FWD1, CMD_STOP}, 1},
+    {{FWD2, CMD_ERROR_04, CMD_STOP}, 1},
+  };
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  char decompiled[MAX_CMD_COUNT];
+  char unterminated[COMMAND_LIST_SIZE + 2];
+  uint32_t seed = 5;
+  int errors[2] = {0, 0};
+  int test;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+    }
+    makeDiagonalPath(input);
+    if (countErrors(commandList)) {
+      continue;
+    }
+    if (decompilePath(commandList, decompiled, sizeof (decompiled)) != -1) {
+      errors[0]++;
+      continue;
+    }
+    if (strcmp(decompiled, input) != 0) {
+      if (test >= testCountDiagonal() || (!strstr(input, "RRR") && !strstr(input, "LLL"))) {
+        errors[0]++;
+        continue;
+      }
+      memcpy(expected, commandList, sizeof (expected));
+      makeDiagonalPath(decompiled);
+      if (compareCommands(expected, commandList, MAX_CMD_COUNT) != -1) {
+        errors[0]++;
+      }
+    }
+  }
+  for (test = 0; test < (int) (sizeof (malformed) / sizeof (malformed[0])); test++) {
+    if (decompilePath(malformed[test].list, decompiled, sizeof (decompiled)) != malformed[test].errorPos) {
+      errors[1]++;
+    }
+  }
+  memset(expected, FWD1, sizeof (expected));
+  errors[1] += decompilePath(expected, unterminated, sizeof (unterminated)) != COMMAND_LIST_SIZE - 1;
+  printf("decompile test round trip : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("decompile test malformed  : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * The stride table must match the single step machine entry by entry
+ * and the stride generator must give the same list for every route,
+ * including routes with bad characters and with the terminator at every
+ * position within a stride.
+ */
+static int runTestsStride(void) {
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 6;
+  int errors[2] = {0, 0};
+  int test;
+  if (strideInit() != 0 || strideVerify() != 0) {
+    errors[0]++;
+  }
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      int length = makeRandomRoute(route, sizeof (route), &seed);
+      if (test % 7 == 0) {
+        route[(seed >> 8) % length] = "FLRSX"[(seed >> 4) % 5];
+      }
+    }
+    makeDiagonalPath(input);
+    memcpy(expected, commandList, sizeof (expected));
+    makeDiagonalPathStride(input);
+    if (compareCommands(expected, commandList, MAX_CMD_COUNT) != -1) {
+      errors[1]++;
+    }
+  }
+  printf("stride test table      : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("stride test generate   : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * Every route must survive packing and unpacking and the generator must
+ * give the same list from the packed route as from the string. Routes
+ * with a bad character are packed up to that character and generated as
+ * a route that does not reach the goal, which must match the string cut
+ * short at the same place.
+ */
+static int runTestsPacked(void) {
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  static packedRoute_t packed;
+  char route[MAX_CMD_COUNT];
+  char unpacked[MAX_CMD_COUNT];
+  uint32_t seed = 7;
+  int errors[2] = {0, 0};
+  int test;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    int bad;
+    if (test < testCountDiagonal()) {
+      strcpy(route, testPairsDiagonal[test].input);
+    } else {
+      int length = makeRandomRoute(route, sizeof (route), &seed);
+      if (test % 5 == 0) {
+        route[(seed >> 8) % length] = "FLRSX"[(seed >> 4) % 5];
+      }
+    }
+    bad = routePack(&packed, route);
+    if (bad >= 0) {
+      route[bad] = 0;
+    } else if (routeTerminated(&packed)) {
+      *(strchr(route, 'S') + 1) = 0;
+    }
+    if (routeUnpack(&packed, unpacked, sizeof (unpacked)) < 0 || strcmp(unpacked, route) != 0) {
+      errors[0]++;
+    }
+    makeDiagonalPath(route);
+    memcpy(expected, commandList, sizeof (expected));
+    makeDiagonalPathPacked(&packed);
+    if (compareCommands(expected, commandList, MAX_CMD_COUNT) != -1) {
+      errors[1]++;
+    }
+  }
+  printf("packed test round trip : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("packed test generate   : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * The queue must hand items back in order, refuse a push when full and
+ * a pop when empty, and keep doing so as its positions wrap around.
+ */
+static int runTestsQueue(void) {
+  static queue_t queue;
+  static int items[8];
+  int errors = 0;
+  int capacity = queueInit(&queue, 5);
+  int lap;
+  int i;
+  void *item;
+  if (capacity != 8) {
+    errors++;
+  }
+  for (lap = 0; lap < 3; lap++) {
+    for (i = 0; i < capacity; i++) {
+      errors += !queuePush(&queue, &items[i]);
+    }
+    errors += queuePush(&queue, &items[0]);
+    for (i = 0; i < capacity; i++) {
+      errors += !queuePop(&queue, &item) || item != &items[i];
+    }
+    errors += queuePop(&queue, &item);
+    for (i = 0; i < 5; i++) {
+      queuePush(&queue, &items[i]);
+      errors += !queuePop(&queue, &item) || item != &items[i];
+    }
+  }
+  printf("queue test             : %s\n", errors ? "FAIL" : " OK ");
+  return errors != 0;
+}
+
+/*
+ * Paths generated into an arena must match the same paths generated into
+ * the commandList, must stay intact while the arena fills up and must
+ * leave the commandList in use afterwards. A path with no room is
+ * refused and fits again after a reset, a path that exactly fills its
+ * room is kept and a list with no CMD_STOP is never stored.
+ */
+static int runTestsArena(void) {
+  static uint8_t memory[1024];
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  static COMMAND first[COMMAND_LIST_SIZE];
+  arena_t arena;
+  pathResult_t path;
+  pathResult_t firstPath = {NULL, 0};
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 11;
+  int errors[2] = {0, 0};
+  int resets = 0;
+  int length = 0;
+  int test;
+  arenaInit(&arena, memory, sizeof (memory));
+  for (test = 0; test < RANDOM_ROUTE_COUNT; test++) {
+    makeRandomRoute(route, sizeof (route), &seed);
+    makeDiagonalPath(route);
+    memcpy(expected, commandList, sizeof (expected));
+    arenaBeginPath(&arena);
+    makeDiagonalPath(route);
+    if (arenaEndPath(&arena, &path) != 0) {
+      arenaReset(&arena);
+      resets++;
+      arenaBeginPath(&arena);
+      makeDiagonalPath(route);
+      if (arenaEndPath(&arena, &path) != 0) {
+        errors[0]++;
+        continue;
+      }
+    }
+    if (arena.paths == 1) {
+      firstPath = path;
+      memcpy(first, expected, sizeof (first));
+    }
+    errors[0] += compareCommands(expected, path.commands, MAX_CMD_COUNT) != -1;
+    errors[0] += path.commands[path.length] != CMD_STOP || path.commands[path.length - 1] == CMD_STOP;
+    errors[0] += compareCommands(first, firstPath.commands, MAX_CMD_COUNT) != -1;
+    makeDiagonalPath(route);
+    errors[0] += compareCommands(expected, commandList, MAX_CMD_COUNT) != -1;
+  }
+  errors[0] += resets == 0;
+  arenaInit(&arena, memory, 8);
+  arenaBeginPath(&arena);
+  makeDiagonalPath("FRFLFRFLFRFLFRFLS");
+  errors[1] += arenaEndPath(&arena, &path) != -1 || arena.used != 0;
+  makeDiagonalPath("FRFLFRFLFRFLFRFLS");
+  errors[1] += arenaStorePath(&arena, commandList, &path) != -1;
+  errors[1] += commandList[0] == CMD_STOP;
+  arenaInit(&arena, memory, sizeof (memory));
+  errors[1] += arenaStorePath(&arena, commandList, &path) != 0 || compareCommands(commandList, path.commands, MAX_CMD_COUNT) != -1;
+  while (commandList[length] != CMD_STOP) {
+    length++;
+  }
+  arenaInit(&arena, memory, (size_t) length + 1);
+  arenaBeginPath(&arena);
+  makeDiagonalPath("FRFLFRFLFRFLFRFLS");
+  errors[1] += arenaEndPath(&arena, &path) != 0 || path.length != length || arena.used != (size_t) length + 1;
+  arenaInit(&arena, memory, (size_t) length);
+  arenaBeginPath(&arena);
+  makeDiagonalPath("FRFLFRFLFRFLFRFLS");
+  errors[1] += arenaEndPath(&arena, &path) != -1 || arena.used != 0;
+  memset(expected, CMD_END, sizeof (expected));
+  arenaInit(&arena, memory, sizeof (memory));
+  errors[1] += arenaStorePath(&arena, expected, &path) != -1 || arena.used != 0;
+  printf("arena test generate    : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("arena test overflow    : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+#ifdef PATH_TRACE
+/*
+ * The records for a path must give back its command list, chain each
+ * state to the next and end in the exit state. Once the ring has
+ * wrapped a snapshot holds the latest TRACE_SIZE records, and a dump of
+ * them decodes to one line per record and one per path. These run in
+ * the PATH_TRACE build, make test-trace.
+ */
+static int runTestsTrace(void) {
+  static uint32_t records[TRACE_SIZE];
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 5;
+  traceRing_t *ring = traceCurrent();
+  int errors[2] = {0, 0};
+  int paths = 0;
+  int test;
+  for (test = 0; test < testCountDiagonal(); test++) {
+    int n;
+    int c = 0;
+    int i;
+    traceClear(ring);
+    makeDiagonalPath(testPairsDiagonal[test].input);
+    n = traceSnapshot(ring, records, TRACE_SIZE);
+    for (i = 0; i < n; i++) {
+      uint32_t r = records[i];
+      if (((r & TRACE_FIRST) != 0) != (i == 0)) {
+        errors[0]++;
+      }
+      if (i > 0 && TRACE_INDEX(r) == 0 && TRACE_AFTER(records[i - 1]) != TRACE_BEFORE(r)) {
+        errors[0]++;
+      }
+      if (r & TRACE_EMITTED) {
+        errors[0] += TRACE_COMMAND(r) != commandList[c++];
+      }
+    }
+    if (n == 0 || TRACE_AFTER(records[n - 1]) != PathExit || c != commandCount()) {
+      errors[0]++;
+    }
+  }
+  traceClear(ring);
+  while (atomic_load(&ring->head) < 3 * TRACE_SIZE) {
+    makeRandomRoute(route, sizeof (route), &seed);
+    makeDiagonalPath(route);
+  }
+  if (traceSnapshot(ring, records, TRACE_SIZE) != TRACE_SIZE) {
+    errors[1]++;
+  } else {
+    FILE *dump = tmpfile();
+    FILE *text = tmpfile();
+    char line[80];
+    int lines = 0;
+    int i;
+    for (i = 0; i < TRACE_SIZE; i++) {
+      unsigned char bytes[4] = {records[i], records[i] >> 8, records[i] >> 16, records[i] >> 24};
+      fwrite(bytes, 1, sizeof (bytes), dump);
+      paths += (records[i] & TRACE_FIRST) != 0;
+    }
+    rewind(dump);
+    errors[1] += traceDecode(dump, text) != TRACE_SIZE;
+    rewind(text);
+    while (fgets(line, sizeof (line), text) != NULL) {
+      lines++;
+    }
+    errors[1] += lines != TRACE_SIZE + paths || TRACE_AFTER(records[TRACE_SIZE - 1]) != PathExit;
+    fclose(dump);
+    fclose(text);
+  }
+  printf("trace test record      : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("trace test wrap        : %s  %d paths\n", errors[1] ? "FAIL" : " OK ", paths);
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+#endif
+
+/*
+ * Segments timed exactly with a known model must fit back to that model,
+ * and parameters no segment exercises must keep the prior. Logs and
+ * models must survive being written as text and read back, and every
+ * command name must parse back to its command.
+ */
+static int runTestsFit(void) {
+  static timeFit_t fit;
+  timeModel_t truth = defaultTimeModel;
+  timeModel_t model;
+  char route[MAX_CMD_COUNT];
+  char name[16];
+  COMMAND cmd;
+  uint32_t seed = 17;
+  double rms;
+  int errors[2] = {0, 0};
+  int test;
+  int i;
+  FILE *file;
+  for (i = 0; i < FIT_PARAMS; i++) {
+    *timeModelParam(&truth, i) *= 0.9f + 0.01f * (i % 20);
+  }
+  truth.straightBase = 0.02f;
+  fitClear(&fit);
+  for (test = 0; test < 2000; test++) {
+    int p = 0;
+    makeRandomRoute(route, 40, &seed);
+    makeDiagonalPath(route);
+    while (commandList[p] != CMD_STOP) {
+      int n = commandList[p + 1] == CMD_STOP ? 1 : 1 + (p + test) % 2;
+      fitAddSegment(&fit, commandList + p, n, commandTime(&truth, commandList[p]) +
+                    (n > 1 ? commandTime(&truth, commandList[p + 1]) : 0.0f));
+      p += n;
+    }
+  }
+  if (fitSolve(&fit, &defaultTimeModel, 1e-6, &model, &rms) != 0 || rms > 1e-5) {
+    errors[0]++;
+  }
+  for (i = 0; i < FIT_PARAMS; i++) {
+    float expected = fit.uses[i] ? *timeModelParam(&truth, i) : *timeModelParam((timeModel_t *) &defaultTimeModel, i);
+    if (fabsf(*timeModelParam(&model, i) - expected) > 1e-4f) {
+      errors[0]++;
+    }
+  }
+  file = tmpfile();
+  fprintf(file, "# time,commands\n0.5,FWD3,SS90SR\n\nbad,FWD1\n0.25,DIA2,SD45X\n0.3,DD90L\n");
+  rewind(file);
+  fitClear(&fit);
+  if (fitReadCsv(&fit, file) != 2 || fit.rejected != 2 || fit.uses[6 + DD90L - IP45R] != 1 || fit.uses[0] != 1) {
+    errors[1]++;
+  }
+  fclose(file);
+  file = tmpfile();
+  timeModelWrite(&truth, file, NULL);
+  rewind(file);
+  model = defaultTimeModel;
+  errors[1] += timeModelRead(&model, file) != FIT_PARAMS;
+  for (i = 0; i < FIT_PARAMS; i++) {
+    errors[1] += fabsf(*timeModelParam(&model, i) - *timeModelParam(&truth, i)) > 1e-6f;
+  }
+  fclose(file);
+  for (i = 0; i <= SS90EL; i++) {
+    cmd = CMD_END;
+    formatCommand(i, name, sizeof (name));
+    errors[1] += parseCommand(name, &cmd) != 0 || cmd != i;
+  }
+  errors[1] += parseCommand("FWD", &cmd) == 0 || parseCommand("SS90XR", &cmd) == 0 || parseCommand("DIA32", &cmd) == 0;
+  printf("fit test recover       : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("fit test files         : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+#define CMDQ_TEST_ROUTES 2000
+#define CMDQ_TEST_COMMANDS (CMDQ_TEST_ROUTES * 64)
+
+typedef struct {
+  commandQueue_t queue;
+  COMMAND received[CMDQ_TEST_COMMANDS];
+  int expected;
+} cmdqTest_t;
+
+static void *cmdqConsumer(void *arg) {
+  cmdqTest_t *test = arg;
+  int n = 0;
+  while (n < test->expected) {
+    if (!commandQueuePop(&test->queue, &test->received[n])) {
+      sched_yield();
+      continue;
+    }
+    n++;
+  }
+  return NULL;
+}
+
+/*
+ * A path generated into the queue must come out of it as the same list,
+ * CMD_STOP included, and the queue must refuse a push when full. With
+ * the consumer on another thread, a stream of paths must arrive intact
+ * and in order while they are still being generated.
+ */
+static int runTestsCommandQueue(void) {
+  static cmdqTest_t test;
+  static COMMAND expected[CMDQ_TEST_COMMANDS];
+  static char routes[CMDQ_TEST_ROUTES][40];
+  pthread_t consumer;
+  uint32_t seed = 29;
+  int errors[2] = {0, 0};
+  int count = 0;
+  int t;
+  int i;
+  commandQueueInit(&test.queue);
+  for (t = 0; t < testCountDiagonal(); t++) {
+    COMMAND cmd = CMD_END;
+    commandQueueAttach(&test.queue);
+    makeDiagonalPath(testPairsDiagonal[t].input);
+    commandQueueAttach(NULL);
+    for (i = 0; commandQueuePop(&test.queue, &cmd); i++) {
+      errors[0] += cmd != testPairsDiagonal[t].expected[i];
+    }
+    errors[0] += cmd != CMD_STOP;
+  }
+  for (i = 0; i < CMDQ_SIZE; i++) {
+    errors[0] += !commandQueuePush(&test.queue, (COMMAND) i);
+  }
+  errors[0] += commandQueuePush(&test.queue, FWD1);
+  for (i = 0; i < CMDQ_SIZE; i++) {
+    COMMAND cmd;
+    errors[0] += !commandQueuePop(&test.queue, &cmd) || cmd != (COMMAND) i;
+  }
+  for (t = 0; t < CMDQ_TEST_ROUTES; t++) {
+    makeRandomRoute(routes[t], sizeof (routes[t]), &seed);
+    makeDiagonalPath(routes[t]);
+    memcpy(expected + count, commandList, commandCount());
+    count += commandCount();
+  }
+  commandQueueInit(&test.queue);
+  test.expected = count;
+  if (pthread_create(&consumer, NULL, cmdqConsumer, &test) != 0) {
+    errors[1]++;
+  } else {
+    commandQueueAttach(&test.queue);
+    for (t = 0; t < CMDQ_TEST_ROUTES; t++) {
+      makeDiagonalPath(routes[t]);
+    }
+    commandQueueAttach(NULL);
+    pthread_join(consumer, NULL);
+    errors[1] += memcmp(expected, test.received, count) != 0;
+  }
+  printf("cmdqueue test single   : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("cmdqueue test threads  : %s  %d commands\n", errors[1] ? "FAIL" : " OK ", count);
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * Every registered generator must give the same lists as the reference
+ * for the test routes and a set of random routes. Routes the packed
+ * generator cannot take are skipped, not compared with themselves.
+ */
+static int runTestsGenerators(void) {
+  static char random[1000][MAX_CMD_COUNT];
+  static const char *routes[1000 + MAX_CMD_COUNT];
+  generatorComparison_t result;
+  uint32_t seed = 23;
+  int errors = 0;
+  int count = 0;
+  int i;
+  for (i = 0; i < testCountDiagonal() && i < MAX_CMD_COUNT; i++) {
+    routes[count++] = testPairsDiagonal[i].input;
+  }
+  for (i = 0; i < 1000; i++) {
+    makeRandomRoute(random[i], MAX_CMD_COUNT, &seed);
+    routes[count++] = random[i];
+  }
+  for (i = 1; i < generatorCount(); i++) {
+    long unpacked = 0;
+    int r;
+    errors += compareGenerators(generatorAt(0), generatorAt(i), routes, count, 0, &result) != 0;
+    for (r = 0; r < count && strcmp(generatorAt(i)->name, "packed") == 0; r++) {
+      packedRoute_t packed;
+      unpacked += routePack(&packed, routes[r]) != -1;
+    }
+    errors += result.skipped != unpacked || result.routes + result.skipped != count;
+  }
+  errors += findGenerator("packed") == NULL || findGenerator("packed")->accepts == NULL;
+  errors += findGenerator("reference") != generatorAt(0) || findGenerator("none") != NULL;
+  printf("generator test registry: %s  %d generators\n", errors ? "FAIL" : " OK ", generatorCount());
+  return errors != 0;
+}
+
+/*
+ * Run the test routes and a set of random routes through two generators,
+ * show the first route where they disagree and compare their speed.
+ */
+static int runCompare(const generator_t *a, const generator_t *b) {
+  static char random[RANDOM_ROUTE_COUNT][MAX_CMD_COUNT];
+  static const char *routes[RANDOM_ROUTE_COUNT + MAX_CMD_COUNT];
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  generatorComparison_t result;
+  uint32_t seed = 3;
+  int count = 0;
+  int i;
+  for (i = 0; i < testCountDiagonal() && i < MAX_CMD_COUNT; i++) {
+    routes[count++] = testPairsDiagonal[i].input;
+  }
+  for (i = 0; i < RANDOM_ROUTE_COUNT; i++) {
+    makeRandomRoute(random[i], MAX_CMD_COUNT, &seed);
+    routes[count++] = random[i];
+  }
+  if (compareGenerators(a, b, routes, count, 10, &result) != 0 && result.firstMismatch < 0) {
+    printf("could not initialise %s or %s\n", a->name, b->name);
+    return EXIT_FAILURE;
+  }
+  printf("%ld routes, %ld characters: %ld lists differ, %ld routes skipped\n", result.routes, result.characters,
+         result.mismatches, result.skipped);
+  if (result.firstMismatch >= 0) {
+    const char *route = routes[result.firstMismatch];
+    a->generate(route);
+    memcpy(expected, commandList, sizeof (expected));
+    b->generate(route);
+    printf("first difference at route %d: %s\n", result.firstMismatch, route);
+    listComparison(expected, commandList, MAX_CMD_COUNT);
+  }
+  printf("%-10s %8.2f ns/char\n", a->name, (double) result.elapsed[0] / (10.0 * result.characters));
+  printf("%-10s %8.2f ns/char  %.2fx\n", b->name, (double) result.elapsed[1] / (10.0 * result.characters),
+         (double) result.elapsed[0] / result.elapsed[1]);
+  return result.mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * The hash kept up to date one wall at a time must match the hash of the
+ * whole maze, whichever side a wall is set from. Exploring with a table
+ * must make the same moves as without, and exploring the same maze
+ * again must take nearly every decision from the table. Only results
+ * that were evicted by a later one in the same slot are planned again.
+ */
+static int runTestsTranspose(void) {
+  static maze_t maze;
+  static maze_t known;
+  static exploreResult_t plain;
+  static exploreResult_t result;
+  static transTable_t table;
+  exploreConfig_t config = {0};
+  uint32_t seed = 37;
+  uint64_t hash;
+  int errors[2] = {0, 0};
+  int hits = 0;
+  int test;
+  int i;
+  mazeInitExplore(&known);
+  hash = zobristMaze(&known);
+  for (i = 0; i < 20000; i++) {
+    int cell;
+    int heading;
+    int present;
+    seed = seed * 1664525u + 1013904223u;
+    cell = (seed >> 8) % MAZE_CELLS;
+    heading = (seed >> 20) & 3;
+    present = (seed >> 24) & 1;
+    hash = zobristSetWall(hash, &known, cell, heading, present);
+    mazeSetWall(&known, cell, heading, present);
+    errors[0] += hash != zobristMaze(&known);
+  }
+  errors[0] += zobristPosition(START_CELL, NORTH) == zobristPosition(START_CELL, EAST);
+  if (transInit(&table, 12) != 0) {
+    errors[1]++;
+  } else {
+    for (test = 0; test < EXPLORE_TEST_COUNT; test++) {
+      int run;
+      mazeGenerate(&maze, 3000 + test);
+      transClear(&table);
+      config.table = NULL;
+      exploreResultClear(&plain);
+      exploreMaze(&maze, &config, &plain);
+      config.table = &table;
+      for (run = 0; run < 2; run++) {
+        exploreResultClear(&result);
+        exploreMaze(&maze, &config, &result);
+        if (result.steps != plain.steps || result.cellsVisited != plain.cellsVisited ||
+            result.reachedGoal != plain.reachedGoal || strcmp(result.route, plain.route) != 0) {
+          errors[1]++;
+        }
+        errors[1] += result.tableHits + result.tableMisses != result.steps;
+        errors[1] += run == 1 && result.tableMisses > result.steps / 10;
+        hits += run == 1 ? result.tableHits : 0;
+      }
+    }
+    transFree(&table);
+  }
+  printf("transpose test hash    : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("transpose test explore : %s  %d second run hits\n", errors[1] ? "FAIL" : " OK ", hits);
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * The mapped generator must give the same list as the plain one. Every
+ * span must be in order and, for a valid route, every character up to
+ * the S must be in one. The cell of each span must be exactly the cell
+ * the pose model reaches after the moves before the span starts, or -1
+ * once the route has left the maze.
+ */
+static const char *const offMazeRoutes[] = {
+  "FLFFFFFFFFFS",
+  "RRFLFFS",
+  "FFFFFFFFFFFFFFFFFFRFS",
+};
+
+static int runTestsSourceMap(void) {
+  static sourceSpan_t map[COMMAND_LIST_SIZE];
+  static COMMAND expected[COMMAND_LIST_SIZE];
+  const int offMaze = (int) (sizeof (offMazeRoutes) / sizeof (offMazeRoutes[0]));
+  char route[MAX_CMD_COUNT];
+  char prefix[MAX_CMD_COUNT];
+  uint32_t seed = 41;
+  int errors[2] = {0, 0};
+  int offCells = 0;
+  int test;
+  int k;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT + offMaze; test++) {
+    const char *input = route;
+    int length;
+    int count;
+    int covered = 0;
+    int valid;
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else if (test < testCountDiagonal() + RANDOM_ROUTE_COUNT) {
+      makeRandomRoute(route, sizeof (route), &seed);
+    } else {
+      input = offMazeRoutes[test - testCountDiagonal() - RANDOM_ROUTE_COUNT];
+    }
+    makeDiagonalPath(input);
+    memcpy(expected, commandList, sizeof (expected));
+    count = makeDiagonalPathMapped(input, CELL(7, 0), NORTH, map, COMMAND_LIST_SIZE);
+    if (count != commandCount() || memcmp(expected, commandList, count) != 0) {
+      errors[0]++;
+      continue;
+    }
+    valid = countErrors(commandList) == 0;
+    length = (int) strcspn(input, "S") + 1;
+    for (k = 0; k < count; k++) {
+      if (map[k].start >= map[k].end || (k > 0 && map[k].start < map[k - 1].start)
+              || (valid && map[k].start > covered) || map[k].end > length) {
+        errors[0]++;
+      }
+      if (map[k].end > covered) {
+        covered = map[k].end;
+      }
+    }
+    if (valid && covered != length) {
+      errors[0]++;
+    }
+    for (k = 0; k < count; k++) {
+      pose_t pose;
+      int x;
+      int y;
+      int cell = -1;
+      memcpy(prefix, input, map[k].start);
+      prefix[map[k].start] = 'S';
+      poseStart(&pose);
+      if (poseFollowRoute(&pose, prefix) != -1) {
+        errors[1]++;
+        continue;
+      }
+      x = 7 + pose.x / 2;
+      y = pose.y / 2;
+      if (x >= 0 && x < MAZE_WIDTH && y >= 0 && y < MAZE_WIDTH) {
+        cell = CELL(x, y);
+      }
+      errors[1] += map[k].cell != cell;
+      offCells += map[k].cell < 0;
+    }
+  }
+  errors[1] += offCells == 0;
+  printf("sourcemap test spans   : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("sourcemap test cells   : %s\n", errors[1] ? "FAIL" : " OK ");
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+/*
+ * A batch must give every route the same list as generating it alone,
+ * sorted or not. The routes are random routes and variants of them that
+ * branch at random points, with duplicates, routes that are prefixes of
+ * others and the test routes with their errors. The scratch memory the
+ * batch takes from the arena must be given back, and a batch with no room
+ * for it must fail.
+ */
+#define BATCH_TEST_ROUTES 2000
+
+static int compareStrings(const void *a, const void *b) {
+  return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+static int runTestsBatch(void) {
+  static char store[BATCH_TEST_ROUTES][MAX_CMD_COUNT];
+  static const char *routes[BATCH_TEST_ROUTES];
+  static pathResult_t results[BATCH_TEST_ROUTES];
+  static uint8_t memory[BATCH_TEST_ROUTES * COMMAND_LIST_SIZE];
+  arena_t arena;
+  uint32_t seed = 43;
+  int errors = 0;
+  int count = 0;
+  int sorted;
+  int r;
+  for (r = 0; r < testCountDiagonal() && count < BATCH_TEST_ROUTES; r++) {
+    routes[count++] = testPairsDiagonal[r].input;
+  }
+  while (count < BATCH_TEST_ROUTES) {
+    int length = makeRandomRoute(store[count], MAX_CMD_COUNT, &seed);
+    routes[count] = store[count];
+    count++;
+    for (r = 0; r < 8 && count < BATCH_TEST_ROUTES; r++) {
+      int cut;
+      seed = seed * 1664525u + 1013904223u;
+      cut = (int) ((seed >> 8) % length);
+      memcpy(store[count], store[count - 1 - r], cut);
+      makeRandomRoute(store[count] + cut, MAX_CMD_COUNT - cut, &seed);
+      if (r == 7) {
+        store[count][cut] = 0;
+      }
+      routes[count] = store[count];
+      count++;
+    }
+  }
+  for (sorted = 0; sorted < 2; sorted++) {
+    if (sorted) {
+      qsort(routes, BATCH_TEST_ROUTES, sizeof (routes[0]), compareStrings);
+    }
+    arenaInit(&arena, memory, sizeof (memory));
+    if (makeDiagonalPathBatch(routes, BATCH_TEST_ROUTES, sorted, &arena, results) != 0) {
+      errors++;
+      continue;
+    }
+    errors += arena.size != sizeof (memory) || arena.paths != BATCH_TEST_ROUTES;
+    for (r = 0; r < BATCH_TEST_ROUTES; r++) {
+      makeDiagonalPath(routes[r]);
+      if (commandCount() < COMMAND_LIST_SIZE
+              && (results[r].length + 1 != commandCount() || memcmp(results[r].commands, commandList, commandCount()) != 0)) {
+        errors++;
+      }
+    }
+  }
+  arenaInit(&arena, memory, 64);
+  errors += makeDiagonalPathBatch(routes, BATCH_TEST_ROUTES, 1, &arena, results) != -1 || arena.used != 0 || arena.size != 64;
+  printf("batch test prefixes    : %s\n", errors ? "FAIL" : " OK ");
+  return errors != 0;
+}
+
+/*
+ * Every integrated turn has a name that parses back to it and parts that
+ * fuse back to it. On the shortest routes through generated mazes, fusing
+ * must leave the mouse in the same place along the same route, survive
+ * the codec and never make the estimated run slower. Mazes with a zigzag
+ * on a diagonal must get faster.
+ */
+#define INTEGRATED_MAZE_COUNT 200
+
+static int runTestsIntegrated(void) {
+  static maze_t maze;
+  static uint16_t dist[MAZE_CELLS];
+  static uint8_t stream[4 * COMMAND_LIST_SIZE];
+  COMMAND plain[COMMAND_LIST_SIZE];
+  COMMAND fused[COMMAND_LIST_SIZE];
+  COMMAND decoded[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  char text[MAX_CMD_COUNT];
+  char other[MAX_CMD_COUNT];
+  int errors[2] = {0, 0};
+  int faster = 0;
+  float before = 0.0f;
+  float after = 0.0f;
+  int test;
+  int i;
+  for (i = 0; i < INTEGRATED_COUNT; i++) {
+    COMMAND cmd = CMD_INTEGRATED + i;
+    COMMAND parsed = CMD_STOP;
+    COMMAND parts[INTEGRATED_PARTS];
+    formatCommand(cmd, text, sizeof (text));
+    if (parseCommand(text, &parsed) != 0 || parsed != cmd) {
+      errors[0]++;
+    }
+    if (integratedParts(cmd, parts) != INTEGRATED_PARTS || integrateTurns(parts[0], parts[1], parts[2]) != cmd) {
+      errors[0]++;
+    }
+  }
+  if (integratedParts(SD45R, decoded) != 0 || integrateTurns(SD45R, DIA2, DS45R) != CMD_STOP
+      || integrateTurns(SD45R, DIA3, DS45L) != CMD_STOP || integrateTurns(SS90SR, DIA2, DS45L) != CMD_STOP) {
+    errors[0]++;
+  }
+  printf("integrated test names  : %s\n", errors[0] ? "FAIL" : " OK ");
+
+  for (test = 0; test < INTEGRATED_MAZE_COUNT; test++) {
+    decoder_t decoder;
+    driveResult_t result;
+    pose_t expected;
+    pose_t actual;
+    float t0;
+    float t1;
+    int heading;
+    int length;
+    int n;
+    mazeGenerate(&maze, 4000 + test);
+    floodMaze(&maze, dist);
+    makeRoute(&maze, dist, START_CELL, NORTH, route, &heading);
+    makeDiagonalPath(route);
+    peepholeOptimise(commandList, CAP_ALL, timeModelCost, &defaultTimeModel);
+    memcpy(plain, commandList, sizeof (plain));
+    memcpy(fused, commandList, sizeof (fused));
+    peepholeOptimise(fused, CAP_ALL | CAP_INTEGRATED, timeModelCost, &defaultTimeModel);
+    poseStart(&expected);
+    poseStart(&actual);
+    poseRun(&expected, plain, COMMAND_LIST_SIZE);
+    if (poseRun(&actual, fused, COMMAND_LIST_SIZE) != -1 || !poseEqual(&expected, &actual)) {
+      errors[1]++;
+    }
+    if (decompilePath(plain, text, sizeof (text)) != -1 || decompilePath(fused, other, sizeof (other)) != -1
+        || strcmp(text, other) != 0) {
+      errors[1]++;
+    }
+    if (driveList(&maze, fused, &defaultMouseModel, NULL, 0, &result) != DRIVE_OK) {
+      errors[1]++;
+    }
+    for (n = 0; fused[n] != CMD_STOP; n++) {
+    }
+    length = encodeList(fused, stream, sizeof (stream), CODEC_FRAME_COMMANDS);
+    decoderInit(&decoder, decoded, COMMAND_LIST_SIZE);
+    if (length < 0 || decodeBytes(&decoder, stream, length) != n || memcmp(decoded, fused, n + 1) != 0) {
+      errors[1]++;
+    }
+    t0 = listCost(timeModelCost, &defaultTimeModel, plain, COMMAND_LIST_SIZE);
+    t1 = listCost(timeModelCost, &defaultTimeModel, fused, COMMAND_LIST_SIZE);
+    if (t1 > t0) {
+      errors[1]++;
+    }
+    faster += t1 < t0;
+    before += t0;
+    after += t1;
+  }
+  if (faster == 0 || after >= before) {
+    errors[1]++;
+  }
+  printf("integrated test mazes  : %s  %d of %d faster, %.1f%% saved\n", errors[1] ? "FAIL" : " OK ",
+         faster, INTEGRATED_MAZE_COUNT, 100.0f * (before - after) / before);
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+static unsigned commandNeeds(COMMAND cmd) {
+  if (cmd >= DIA0 && cmd <= DIA31) {
+    return CAP_DIAGONAL;
+  }
+  if (cmd >= IP45R && cmd <= IP180L) {
+    return CAP_IN_PLACE;
+  }
+  if (cmd == SS180R || cmd == SS180L) {
+    return CAP_SMOOTH_180;
+  }
+  if (cmd >= SD45R && cmd <= DD90L) {
+    return CAP_DIAGONAL;
+  }
+  if (cmd >= SS90SR && cmd <= SS90EL) {
+    return CAP_SMOOTH_90;
+  }
+  if (cmd >= CMD_INTEGRATED && cmd < CMD_INTEGRATED + INTEGRATED_COUNT) {
+    return CAP_INTEGRATED;
+  }
+  return 0;
+}
+
+/*
+ * Every strategy must drive a valid route to the same place using only
+ * the commands it claims, and the best pick must cost no more than any
+ * strategy the capabilities allow. A pick made into a buffer of the
+ * caller's must land there and leave the commandList alone.
+ */
+static int runTestsStrategy(void) {
+  static const unsigned capabilities[3] = {CAP_ALL, CAP_IN_PLACE | CAP_SMOOTH_90 | CAP_SMOOTH_180, CAP_IN_PLACE};
+  static COMMAND list[COMMAND_LIST_SIZE];
+  static COMMAND own[COMMAND_LIST_SIZE];
+  char route[MAX_CMD_COUNT];
+  uint32_t seed = 31;
+  int errors[2] = {0, 0};
+  int picks[STRATEGY_COUNT] = {0, 0, 0};
+  int test;
+  int s;
+  int i;
+  for (test = 0; test < testCountDiagonal() + RANDOM_ROUTE_COUNT; test++) {
+    const char *input = route;
+    pose_t expected;
+    float times[STRATEGY_COUNT];
+    if (test < testCountDiagonal()) {
+      input = testPairsDiagonal[test].input;
+    } else {
+      makeRandomRoute(route, sizeof (route), &seed);
+    }
+    poseStart(&expected);
+    makeDiagonalPath(input);
+    if (poseFollowRoute(&expected, input) != -1 || countErrors(commandList)) {
+      continue;
+    }
+    for (s = 0; s < STRATEGY_COUNT; s++) {
+      pose_t actual;
+      poseStart(&actual);
+      makeStrategyPath(input, s);
+      times[s] = -1.0f;
+      if (commandList[commandCount() - 1] != CMD_STOP) {
+        continue; // too long for the command list in this style
+      }
+      if (poseRun(&actual, commandList, COMMAND_LIST_SIZE) != -1 || !poseEqual(&expected, &actual)) {
+        errors[0]++;
+      }
+      for (i = 0; i < commandCount(); i++) {
+        errors[0] += (commandNeeds(commandList[i]) & ~strategyCapabilities(s)) != 0;
+      }
+      times[s] = listCost(timeModelCost, &defaultTimeModel, commandList, commandCount());
+    }
+    for (i = 0; i < 3; i++) {
+      float best = 0.0f;
+      int chosen = makeBestPath(input, capabilities[i], timeModelCost, &defaultTimeModel, &best);
+      if (chosen < 0 || listCost(timeModelCost, &defaultTimeModel, commandList, commandCount()) != best
+              || (times[chosen] < 0.0f && i == 0)) {
+        errors[1]++;
+        continue;
+      }
+      for (s = 0; s < STRATEGY_COUNT; s++) {
+        if ((strategyCapabilities(s) & ~capabilities[i]) == 0 && times[s] >= 0.0f && times[s] < best) {
+          errors[1]++;
+        }
+      }
+      if (i == 0) {
+        picks[chosen]++;
+        memcpy(list, commandList, sizeof (list));
+        setCommandBuffer(own, COMMAND_LIST_SIZE);
+        commandList[0] = CMD_END;
+        errors[1] += makeBestPath(input, capabilities[i], timeModelCost, &defaultTimeModel, NULL) != chosen;
+        errors[1] += compareCommands(list, own, MAX_CMD_COUNT) != -1 || commandList[0] != CMD_END;
+        setCommandBuffer(NULL, 0);
+      }
+    }
+  }
+  printf("strategy test geometry : %s\n", errors[0] ? "FAIL" : " OK ");
+  printf("strategy test best     : %s  %d/%d/%d\n", errors[1] ? "FAIL" : " OK ", picks[0], picks[1], picks[2]);
+  return (errors[0] != 0) + (errors[1] != 0);
+}
+
+static void usage(void) {
+  int i;
+  fprintf(stderr, "usage: diagonal-pathgen [--generator=name] [--compare=a,b]\ngenerators:\n");
+  for (i = 0; i < generatorCount(); i++) {
+    fprintf(stderr, "  %-10s %s\n", generatorAt(i)->name, generatorAt(i)->description);
+  }
+}
+
+/*
+ * With --generator the command table tests are run through the named
+ * generator instead of the reference. With --compare only the two named
+ * generators are compared.
+ */
 int main(int argc, char** argv) {
+  const generator_t *generator = generatorAt(0);
   int failures;
-  failures = runTestsDiagonal();
-  printf("\n\n%d tests complete, %d failed\n", testCountDiagonal(), failures);
-  return (EXIT_SUCCESS);
+  int tests;
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--generator=", 12) == 0 && findGenerator(argv[i] + 12) != NULL) {
+      generator = findGenerator(argv[i] + 12);
+      if (generatorInit(generator) != 0) {
+        fprintf(stderr, "could not initialise %s\n", generator->name);
+        return EXIT_FAILURE;
+      }
+    } else if (strncmp(argv[i], "--compare=", 10) == 0 && strchr(argv[i], ',') != NULL) {
+      char names[64];
+      char *second;
+      snprintf(names, sizeof (names), "%s", argv[i] + 10);
+      second = strchr(names, ',');
+      *second++ = 0;
+      if (findGenerator(names) == NULL || findGenerator(second) == NULL) {
+        usage();
+        return EXIT_FAILURE;
+      }
+      return runCompare(findGenerator(names), findGenerator(second));
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  printf("generator: %s\n", generator->name);
+  failures = runTestsDiagonal(generator);
+  tests = testCountDiagonal();
+  failures += runTestsPlanner();
+  tests += PLANNER_TEST_COUNT;
+  failures += runTestsExplore();
+  tests += EXPLORE_TEST_COUNT;
+  failures += runTestsPeephole();
+  tests += 1 + peepholeRuleCount + 8;
+  failures += runTestsSpeeds();
+  tests += 1;
+  failures += runTestsCodec();
+  tests += 4;
+  failures += runTestsDrive();
+  tests += 3;
+  failures += runTestsDecompile();
+  tests += 2;
+  failures += runTestsStride();
+  tests += 2;
+  failures += runTestsPacked();
+  tests += 2;
+  failures += runTestsQueue();
+  tests += 1;
+  failures += runTestsArena();
+  tests += 2;
+  failures += runTestsSpeculate();
+  tests += 3;
+#ifdef PATH_TRACE
+  failures += runTestsTrace();
+  tests += 2;
+#endif
+  failures += runTestsFit();
+  tests += 2;
+  failures += runTestsGenerators();
+  tests += 1;
+  failures += runTestsCommandQueue();
+  tests += 2;
+  failures += runTestsStrategy();
+  tests += 2;
+  failures += runTestsTranspose();
+  tests += 2;
+  failures += runTestsSourceMap();
+  tests += 2;
+  failures += runTestsBatch();
+  tests += 1;
+  failures += runTestsIntegrated();
+  tests += 2;
+  printf("\n\n%d tests complete, %d failed\n", tests, failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
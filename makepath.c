@@ -20,7 +20,12 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include "commands.h"
+#include "makepath.h"
+#include "maze.h"
+#include "trace.h"
 
 /*
  * Generate a command sequence from a string input. The generated path will
@@ -62,246 +67,504 @@ THE SOFTWARE.
  * shown as a comment for each state.
  */
 
-typedef enum {
-  PathStart,
-  PathOrtho_F,
-  PathOrtho_R,
-  PathOrtho_L,
-  PathOrtho_RR,
-  PathOrtho_LL,
-  PathDiag_RL,
-  PathDiag_LR,
-  PathDiag_RR,
-  PathDiag_LL,
-  PathStop,
-  PathExit,
-  PathError
-} state_t;
+/*
+ * The single step is inlined into makeDiagonalPath() so that splitting it
+ * out costs the generator as little as possible.
+ */
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
 
-void makeDiagonalPath(const char * s) {
+/*
+ * One step of the machine. Reads a single character, updates the state
+ * and the cell counter and writes any commands generated to out, which
+ * must have room for PATH_MAX_EMITS of them. Returns the number written.
+ *
+ * Other generators, such as the stride tables, are built from this
+ * function so that there is only one description of the machine.
+ */
+static ALWAYS_INLINE int step(int *pState, char c, int *pX, COMMAND *out) {
+  pathState_t state = (pathState_t) *pState;
+  int x = *pX;
+  int n = 0;
+  switch (state) {
+    case PathStart:
+      if (c == 'F') {
+        x = 1;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        out[n++] = CMD_ERROR_00;
+        state = PathStop;
+      } else if (c == 'L') {
+        out[n++] = CMD_ERROR_00;
+        state = PathStop;
+      } else if (c == 'S') {
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_00;
+        state = PathStop;
+      }
+      break;
+    case PathOrtho_F:
+      if (c == 'F') {
+        x++;
+      } else if (c == 'R') {
+        out[n++] = FWD0 + x;
+        state = PathOrtho_R;
+      } else if (c == 'L') {
+        out[n++] = FWD0 + x;
+        state = PathOrtho_L;
+      } else if (c == 'S') {
+        out[n++] = FWD0 + x;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_01;
+        state = PathStop;
+      }
+      break;
+    case PathOrtho_R:
+      if (c == 'F') {
+        out[n++] = SS90SR;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        state = PathOrtho_RR;
+      } else if (c == 'L') {
+        out[n++] = SD45R;
+        x = 2;
+        state = PathDiag_RL;
+      } else if (c == 'S') {
+        out[n++] = SS90ER;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_02;
+        state = PathStop;
+      }
+      break;
+    case PathOrtho_L:
+      if (c == 'F') {
+        out[n++] = SS90SL;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        out[n++] = SD45L;
+        x = 2;
+        state = PathDiag_LR;
+      } else if (c == 'L') {
+        state = PathOrtho_LL;
+      } else if (c == 'S') {
+        out[n++] = SS90EL;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_03;
+        state = PathStop;
+      }
+      break;
+    case PathOrtho_RR:
+      if (c == 'F') {
+        out[n++] = SS180R;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        out[n++] = CMD_ERROR_04;
+        state = PathStop;
+      } else if (c == 'L') {
+        out[n++] = SD135R;
+        x = 2;
+        state = PathDiag_RL;
+      } else if (c == 'S') {
+        out[n++] = SS180R;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_04;
+        state = PathStop;
+      }
+      break;
+    case PathDiag_RL:
+      if (c == 'F') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS45L;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        x += 1;
+        state = PathDiag_LR;
+      } else if (c == 'L') {
+        state = PathDiag_LL;
+      } else if (c == 'S') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS45L;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_05;
+        state = PathStop;
+      }
+      break;
+    case PathDiag_LR:
+      if (c == 'F') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS45R;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        state = PathDiag_RR;
+      } else if (c == 'L') {
+        x += 1;
+        state = PathDiag_RL;
+      } else if (c == 'S') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS45R;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_06;
+        state = PathStop;
+      }
+      break;
+    case PathOrtho_LL:
+      if (c == 'F') {
+        out[n++] = SS180L;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        out[n++] = SD135L;
+        x = 2;
+        state = PathDiag_LR;
+      } else if (c == 'L') {
+        out[n++] = CMD_ERROR_07;
+        state = PathStop;
+      } else if (c == 'S') {
+        out[n++] = SS180L;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_07;
+        state = PathStop;
+      }
+      break;
+    case PathDiag_LL:
+      if (c == 'F') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS135L;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        out[n++] = DIA0 + x;
+        out[n++] = DD90L;
+        x = 2;
+        state = PathDiag_LR;
+      } else if (c == 'L') {
+        out[n++] = CMD_ERROR_08;
+        state = PathStop;
+      } else if (c == 'S') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS135L;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_08;
+        state = PathStop;
+      }
+      break;
+    case PathDiag_RR:
+      if (c == 'F') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS135R;
+        x = 2;
+        state = PathOrtho_F;
+      } else if (c == 'R') {
+        state = PathDiag_RR;
+      } else if (c == 'L') {
+        out[n++] = DIA0 + x;
+        out[n++] = DD90R;
+        x = 2;
+        state = PathDiag_RL;
+      } else if (c == 'S') {
+        out[n++] = DIA0 + x;
+        out[n++] = DS135R;
+        out[n++] = FWD1;
+        state = PathStop;
+      } else {
+        out[n++] = CMD_ERROR_09;
+        state = PathStop;
+      }
+      break;
+    case PathStop:
+      out[n++] = CMD_STOP; // make sure the command list gets terminated
+      state = PathExit;
+      break;
+    default:
+      out[n++] = CMD_ERROR_15;
+      state = PathExit;
+      break;
+  }
+
+  *pState = state;
+  *pX = x;
+  return n;
+}
+
+int pathStep(int *state, char c, int *x, COMMAND *out) {
+  return step(state, c, x, out);
+}
+
+/*
+ * Positions for the source map are kept as (x + 128) * 256 + (y + 128)
+ * so that a move is one add and a route that leaves the maze does no
+ * harm. They are only turned into cells when a span is written.
+ */
+#define MAP_ORIGIN (128 * 256 + 128)
+
+static const int16_t mapDelta[4] = {1, 256, -1, -256};
+
+/*
+ * The number of characters in the turn that leaves each state.
+ */
+static const uint8_t turnLength[PathError + 1] = {1, 1, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 1};
+
+static inline int16_t mapCell(int position) {
+  int x = (position >> 8) - 128;
+  int y = (position & 0xFF) - 128;
+  if (x < 0 || x >= MAZE_WIDTH || y < 0 || y >= MAZE_WIDTH) {
+    return -1;
+  }
+  return CELL(x, y);
+}
+
+/*
+ * Fill in the cells of a source map in one walk along the route. The
+ * spans start in order so the walk never goes back, and every character
+ * before the start of a span is a move since the machine stops at the
+ * first S or bad character.
+ */
+static void mapCells(const char *s, int cell, int heading, sourceSpan_t *map, int count) {
+  int where = MAP_ORIGIN + CELL_X(cell) * 256 + CELL_Y(cell);
+  int j = 0;
+  int k;
+  for (k = 0; k < count; k++) {
+    for (; j < map[k].start; j++) {
+      heading = (heading + (s[j] == 'R') - (s[j] == 'L')) & 3;
+      where += mapDelta[heading];
+    }
+    map[k].cell = mapCell(where);
+  }
+}
+
+/*
+ * The generator loop. With a map it also records the span of each
+ * command as it is emitted, which needs only the state before the step
+ * and the start of the current straight or diagonal. Without one the
+ * compiler drops all of that, so makeDiagonalPath() pays nothing.
+ */
+static ALWAYS_INLINE int generate(const char *s, int cell, int heading, sourceSpan_t *map, int size) {
+  COMMAND out[PATH_MAX_EMITS];
+  const char *start = s;
+  int runStart = 0;
+  int count = 0;
   int x; // a counter for the number of cells to be crossed
-  state_t state;
-  char c;
+  int state;
   clearCommands();
   state = PathStart;
   x = 0;
   while (state != PathExit) {
-    c = *s++;
-    switch (state) {
-      case PathStart:
-        if (c == 'F') {
-          x = 1;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          emitCommand(CMD_ERROR_00);
-          state = PathStop;
-        } else if (c == 'L') {
-          emitCommand(CMD_ERROR_00);
-          state = PathStop;
-        } else if (c == 'S') {
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_00);
-          state = PathStop;
-        }
-        break;
-      case PathOrtho_F:
-        if (c == 'F') {
-          x++;
-        } else if (c == 'R') {
-          emitCommand(FWD0 + x);
-          state = PathOrtho_R;
-        } else if (c == 'L') {
-          emitCommand(FWD0 + x);
-          state = PathOrtho_L;
-        } else if (c == 'S') {
-          emitCommand(FWD0 + x);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_01);
-          state = PathStop;
-        }
-        break;
-      case PathOrtho_R:
-        if (c == 'F') {
-          emitCommand(SS90SR);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          state = PathOrtho_RR;
-        } else if (c == 'L') {
-          emitCommand(SD45R);
-          x = 2;
-          state = PathDiag_RL;
-        } else if (c == 'S') {
-          emitCommand(SS90ER);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_02);
-          state = PathStop;
-        }
-        break;
-      case PathOrtho_L:
-        if (c == 'F') {
-          emitCommand(SS90SL);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          emitCommand(SD45L);
-          x = 2;
-          state = PathDiag_LR;
-        } else if (c == 'L') {
-          state = PathOrtho_LL;
-        } else if (c == 'S') {
-          emitCommand(SS90EL);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_03);
-          state = PathStop;
-        }
-        break;
-      case PathOrtho_RR:
-        if (c == 'F') {
-          emitCommand(SS180R);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          emitCommand(CMD_ERROR_04);
-          state = PathStop;
-        } else if (c == 'L') {
-          emitCommand(SD135R);
-          x = 2;
-          state = PathDiag_RL;
-        } else if (c == 'S') {
-          emitCommand(SS180R);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_04);
-          state = PathStop;
-        }
-        break;
-      case PathDiag_RL:
-        if (c == 'F') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS45L);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          x += 1;
-          state = PathDiag_LR;
-        } else if (c == 'L') {
-          state = PathDiag_LL;
-        } else if (c == 'S') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS45L);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_05);
-          state = PathStop;
-        }
-        break;
-      case PathDiag_LR:
-        if (c == 'F') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS45R);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          state = PathDiag_RR;
-        } else if (c == 'L') {
-          x += 1;
-          state = PathDiag_RL;
-        } else if (c == 'S') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS45R);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_06);
-          state = PathStop;
-        }
-        break;
-      case PathOrtho_LL:
-        if (c == 'F') {
-          emitCommand(SS180L);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          emitCommand(SD135L);
-          x = 2;
-          state = PathDiag_LR;
-        } else if (c == 'L') {
-          emitCommand(CMD_ERROR_07);
-          state = PathStop;
-        } else if (c == 'S') {
-          emitCommand(SS180L);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_07);
-          state = PathStop;
-        }
-        break;
-      case PathDiag_LL:
-        if (c == 'F') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS135L);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          emitCommand(DIA0 + x);
-          emitCommand(DD90L);
-          x = 2;
-          state = PathDiag_LR;
-        } else if (c == 'L') {
-          emitCommand(CMD_ERROR_08);
-          state = PathStop;
-        } else if (c == 'S') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS135L);
-          emitCommand(FWD1);
-          state = PathStop;
-        } else {
-          emitCommand(CMD_ERROR_08);
-          state = PathStop;
-        }
-        break;
-      case PathDiag_RR:
-        if (c == 'F') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS135R);
-          x = 2;
-          state = PathOrtho_F;
-        } else if (c == 'R') {
-          state = 8;
-        } else if (c == 'L') {
-          emitCommand(DIA0 + x);
-          emitCommand(DD90R);
-          x = 2;
-          state = PathDiag_RL;
-        } else if (c == 'S') {
-          emitCommand(DIA0 + x);
-          emitCommand(DS135R);
-          emitCommand(FWD1);
-          state = PathStop;
+    int before = state;
+    int n = step(&state, *s, &x, out);
+    int i;
+    TRACE_STEP(s == start, (int) (s - start), *s, before, state, out, n);
+    for (i = 0; i < n; i++) {
+      emitCommand(out[i]);
+    }
+    if (map != NULL && n > 0) {
+      int position = (int) (s - start);
+      for (i = 0; i < n && count < size; i++, count++) {
+        COMMAND cmd = out[i];
+        map[count].end = (uint16_t) position;
+        if (cmd == CMD_STOP || cmd >= CMD_ERROR_00) {
+          map[count].start = (uint16_t) (cmd == CMD_STOP ? position - 1 : position);
+          map[count].end = (uint16_t) (cmd == CMD_STOP ? position : position + 1);
         } else {
-          emitCommand(CMD_ERROR_09);
-          state = PathStop;
+          int turn = cmd >= CMD_TURN;
+          map[count].start = (uint16_t) (turn ? position - turnLength[before] : runStart);
+          runStart = turn ? position - 1 : runStart;
         }
-        break;
-      case PathStop:
-        emitCommand(CMD_STOP); // make sure the command list gets terminated
-        state = PathExit;
-        break;
-      default:
-        emitCommand(CMD_ERROR_15);
-        state = PathExit;
-        break;
+      }
+      count += n - i;
     }
+    s++;
+  }
+  if (map != NULL) {
+    mapCells(start, cell, heading, map, count < size ? count : size);
   }
+  return count;
+}
+
+void makeDiagonalPath(const char * s) {
+  generate(s, 0, 0, NULL, 0);
+}
+
+/*
+ * Generate a path and its source map from a route that starts in the
+ * given cell and heading. Spans for the first size commands are written
+ * to map. Returns the number of commands generated.
+ */
+int makeDiagonalPathMapped(const char *s, int cell, int heading, sourceSpan_t *map, int size) {
+  return generate(s, cell, heading, map, size);
 }
 
+/*
+ * Generate the paths for a batch of routes that share prefixes, such as
+ * the candidates for each way the walls ahead could turn out. In sorted
+ * order the routes are a depth first walk of their prefix trie, so each
+ * route only has to run the machine from where it leaves the one before.
+ * The state, the cell counter and the number of commands emitted are
+ * kept before every character of the current route; a route resumes
+ * from the checkpoint at the end of its common prefix and keeps the
+ * commands emitted up to there.
+ *
+ * Pass sorted as non-zero if the routes are already in strcmp() order,
+ * otherwise they are sorted here. The lists are written to the arena
+ * rather than through emitCommand() and results[i] is the path for
+ * routes[i]. The order and checkpoints are scratch taken from the top of
+ * the arena for the length of the call, so a batch never allocates.
+ * Returns 0, or -1 if the arena fills, in which case reset it and try
+ * again with a smaller batch, or if a path is longer than commandList
+ * can hold.
+ */
+typedef struct {
+  const char *route;
+  int index;
+} batchRoute_t;
+
+typedef struct {
+  int state;
+  int x;
+  int emitted;
+} checkpoint_t;
+
+static int compareRoutes(const void *a, const void *b) {
+  return strcmp(((const batchRoute_t *) a)->route, ((const batchRoute_t *) b)->route);
+}
+
+static int generateBatch(const batchRoute_t *order, int count, checkpoint_t *checkpoints, COMMAND *work,
+        arena_t *arena, pathResult_t *results) {
+  const char *previous = "";
+  int depth = 0; // checkpoints held for the previous route
+  int r;
+  for (r = 0; r < count; r++) {
+    const char *s = order[r].route;
+    int i = 0;
+    int state = PathStart;
+    int x = 0;
+    int n = 0;
+    while (i < depth && s[i] == previous[i] && s[i] != 0) {
+      i++;
+    }
+    if (depth > 0) {
+      state = checkpoints[i].state;
+      x = checkpoints[i].x;
+      n = checkpoints[i].emitted;
+    }
+    while (state != PathExit) {
+      checkpoints[i].state = state;
+      checkpoints[i].x = x;
+      checkpoints[i].emitted = n;
+      n += step(&state, s[i], &x, work + n);
+      i++;
+    }
+    checkpoints[i].state = state;
+    checkpoints[i].x = x;
+    checkpoints[i].emitted = n;
+    depth = i;
+    previous = s;
+    if (arenaStorePath(arena, work, &results[order[r].index]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int makeDiagonalPathBatch(const char *const *routes, int count, int sorted, arena_t *arena, pathResult_t *results) {
+  batchRoute_t *order;
+  checkpoint_t *checkpoints;
+  COMMAND *work;
+  size_t longest = 0;
+  size_t mark;
+  int status;
+  int r;
+  for (r = 0; r < count; r++) {
+    size_t length = strlen(routes[r]);
+    if (length > longest) {
+      longest = length;
+    }
+  }
+  order = arenaBeginScratch(arena, (size_t) count * sizeof (*order) + (longest + 3) * sizeof (*checkpoints)
+          + (longest + 3) * PATH_MAX_EMITS, &mark);
+  if (order == NULL) {
+    return -1;
+  }
+  checkpoints = (checkpoint_t *) (order + count);
+  work = (COMMAND *) (checkpoints + longest + 3);
+  for (r = 0; r < count; r++) {
+    order[r].route = routes[r];
+    order[r].index = r;
+  }
+  if (!sorted) {
+    qsort(order, (size_t) count, sizeof (*order), compareRoutes);
+  }
+  status = generateBatch(order, count, checkpoints, work, arena, results);
+  arenaEndScratch(arena, mark);
+  return status;
+}
+
+/*
+ * Generate a path straight from a packed route. Each word holds 32 moves
+ * so the route is read one load at a time and never unpacked. The end of
+ * the route is fed to the machine as an S, if the route is terminated,
+ * and a zero so that the output is exactly that for the route string.
+ */
+void makeDiagonalPathPacked(const packedRoute_t *route) {
+  static const char moveChar[4] = {'F', 'L', 'R', '?'};
+  COMMAND out[PATH_MAX_EMITS];
+  int length = routeLength(route);
+  int x = 0;
+  int state = PathStart;
+  uint64_t word = 0;
+  int i;
+  int j;
+  clearCommands();
+  for (i = 0; i < length && state != PathExit; i++) {
+    int before = state;
+    int n;
+    if ((i & 31) == 0) {
+      word = route->moves[i / 32];
+    }
+    n = step(&state, moveChar[word & 3], &x, out);
+    TRACE_STEP(i == 0, i, moveChar[word & 3], before, state, out, n);
+    word >>= 2;
+    for (j = 0; j < n; j++) {
+      emitCommand(out[j]);
+    }
+  }
+  if (state != PathExit && routeTerminated(route)) {
+    int before = state;
+    int n = pathStep(&state, 'S', &x, out);
+    TRACE_STEP(length == 0, length, 'S', before, state, out, n);
+    for (j = 0; j < n; j++) {
+      emitCommand(out[j]);
+    }
+  }
+  while (state != PathExit) {
+    int before = state;
+    int n = pathStep(&state, 0, &x, out);
+    TRACE_STEP(before == PathStart, length + routeTerminated(route), 0, before, state, out, n);
+    for (j = 0; j < n; j++) {
+      emitCommand(out[j]);
+    }
+  }
+}
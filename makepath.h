@@ -27,7 +27,54 @@ THE SOFTWARE.
 extern "C" {
 #endif
 
+#include "commands.h"
+#include "route.h"
+#include "arena.h"
+
+  /*
+   * The generator is a state machine that reads one character at a time.
+   * pathStep() is a single step of it and is exposed so that faster forms
+   * of the machine can be built from it and checked against it. The
+   * machine starts in PathStart and is finished once it reaches PathExit.
+   */
+#define PATH_MAX_EMITS  (3)
+
+  typedef enum {
+    PathStart,
+    PathOrtho_F,
+    PathOrtho_R,
+    PathOrtho_L,
+    PathOrtho_RR,
+    PathOrtho_LL,
+    PathDiag_RL,
+    PathDiag_LR,
+    PathDiag_RR,
+    PathDiag_LL,
+    PathStop,
+    PathExit,
+    PathError
+  } pathState_t;
+
+  /*
+   * A source map says where each command came from. start and end are
+   * the [start, end) range of route characters whose turn or move the
+   * command drives, and cell is the maze cell the first of them starts
+   * in, or -1 off the maze. A turn shares its last character with the
+   * straight or diagonal after it, since that character's move is part
+   * of the next run, and the STOP command maps to the S. An error maps
+   * to the character that caused it.
+   */
+  typedef struct {
+    uint16_t start;
+    uint16_t end;
+    int16_t cell;
+  } sourceSpan_t;
+
+  int pathStep(int *state, char c, int *x, COMMAND *out);
   void makeDiagonalPath(const char * s);
+  int makeDiagonalPathMapped(const char *s, int cell, int heading, sourceSpan_t *map, int size);
+  int makeDiagonalPathBatch(const char *const *routes, int count, int sorted, arena_t *arena, pathResult_t *results);
+  void makeDiagonalPathPacked(const packedRoute_t *route);
 
 #ifdef	__cplusplus
 }
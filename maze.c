@@ -0,0 +1,272 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "maze.h"
+
+/*
+ * Maze storage, loading and generation.
+ *
+ * Walls are always set in pairs so that the two cells either side of a
+ * wall agree about it. The text format is the one used by the
+ * micromouseonline maze files:
+ *
+ *   o---o---o
+ *   |       |
+ *   o   o---o
+ *   |   |   |
+ *   o---o---o
+ *
+ * with north at the top and the start cell in the bottom left corner.
+ */
+
+const int8_t mazeDelta[4] = {1, MAZE_WIDTH, -1, -MAZE_WIDTH};
+
+/*
+ * Returns the index of the cell next to the given cell in the given
+ * direction or -1 if that would be outside the maze.
+ */
+int mazeNeighbour(int cell, int heading) {
+  int x = CELL_X(cell);
+  int y = CELL_Y(cell);
+  switch (heading) {
+    case NORTH:
+      return (y < MAZE_WIDTH - 1) ? cell + 1 : -1;
+    case EAST:
+      return (x < MAZE_WIDTH - 1) ? cell + MAZE_WIDTH : -1;
+    case SOUTH:
+      return (y > 0) ? cell - 1 : -1;
+    default:
+      return (x > 0) ? cell - MAZE_WIDTH : -1;
+  }
+}
+
+/*
+ * Record the state of a single wall. The matching wall in the
+ * neighbouring cell is updated as well and both are marked as known.
+ * Returns non-zero if this changed what is known about the maze.
+ */
+int mazeSetWall(maze_t *maze, int cell, int heading, int present) {
+  uint8_t old = maze->cells[cell];
+  int next = mazeNeighbour(cell, heading);
+  int back = (heading + 2) & 3;
+  maze->cells[cell] |= KNOWN_BIT(heading);
+  if (present) {
+    maze->cells[cell] |= WALL_BIT(heading);
+  } else {
+    maze->cells[cell] &= ~WALL_BIT(heading);
+  }
+  if (next >= 0) {
+    maze->cells[next] |= KNOWN_BIT(back);
+    if (present) {
+      maze->cells[next] |= WALL_BIT(back);
+    } else {
+      maze->cells[next] &= ~WALL_BIT(back);
+    }
+  }
+  return old != maze->cells[cell];
+}
+
+static void setBoundary(maze_t *maze) {
+  int i;
+  for (i = 0; i < MAZE_WIDTH; i++) {
+    mazeSetWall(maze, CELL(i, MAZE_WIDTH - 1), NORTH, 1);
+    mazeSetWall(maze, CELL(MAZE_WIDTH - 1, i), EAST, 1);
+    mazeSetWall(maze, CELL(i, 0), SOUTH, 1);
+    mazeSetWall(maze, CELL(0, i), WEST, 1);
+  }
+}
+
+/*
+ * An empty maze with only the boundary walls. Every wall is known.
+ */
+void mazeClear(maze_t *maze) {
+  memset(maze->cells, 0xF0, sizeof (maze->cells));
+  setBoundary(maze);
+}
+
+/*
+ * The maze as the mouse sees it before a search. Only the boundary and
+ * the east wall of the start cell, which the rules guarantee, are known.
+ */
+void mazeInitExplore(maze_t *maze) {
+  memset(maze->cells, 0, sizeof (maze->cells));
+  setBoundary(maze);
+  mazeSetWall(maze, START_CELL, EAST, 1);
+}
+
+/*
+ * Read a maze from a text buffer. Lines may end in either LF or CRLF.
+ * Returns 0 on success or -1 if the text does not describe a complete
+ * maze of the expected size.
+ */
+int mazeLoadText(maze_t *maze, const char *text) {
+  const char *line[2 * MAZE_WIDTH + 1];
+  int lengths[2 * MAZE_WIDTH + 1];
+  int row = 0;
+  int x;
+  int y;
+  const char *p = text;
+  while (*p && row < 2 * MAZE_WIDTH + 1) {
+    const char *end = p;
+    while (*end && *end != '\n' && *end != '\r') {
+      end++;
+    }
+    if (end != p) {
+      line[row] = p;
+      lengths[row] = (int) (end - p);
+      if (lengths[row] < 4 * MAZE_WIDTH + 1) {
+        return -1;
+      }
+      row++;
+    }
+    p = end;
+    while (*p == '\n' || *p == '\r') {
+      p++;
+    }
+  }
+  if (row != 2 * MAZE_WIDTH + 1) {
+    return -1;
+  }
+  memset(maze->cells, 0xF0, sizeof (maze->cells));
+  for (y = 0; y < MAZE_WIDTH; y++) {
+    const char *top = line[2 * (MAZE_WIDTH - 1 - y)];
+    const char *mid = line[2 * (MAZE_WIDTH - 1 - y) + 1];
+    const char *bottom = line[2 * (MAZE_WIDTH - y)];
+    for (x = 0; x < MAZE_WIDTH; x++) {
+      int cell = CELL(x, y);
+      mazeSetWall(maze, cell, NORTH, top[4 * x + 2] == '-');
+      mazeSetWall(maze, cell, SOUTH, bottom[4 * x + 2] == '-');
+      mazeSetWall(maze, cell, WEST, mid[4 * x] == '|');
+      mazeSetWall(maze, cell, EAST, mid[4 * x + 4] == '|');
+    }
+  }
+  return 0;
+}
+
+/*
+ * Read a maze from a file in the text format. Returns 0 on success.
+ */
+int mazeLoadFile(maze_t *maze, const char *filename) {
+  char text[2 * MAZE_TEXT_SIZE];
+  size_t n;
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL) {
+    return -1;
+  }
+  n = fread(text, 1, sizeof (text) - 1, fp);
+  fclose(fp);
+  text[n] = 0;
+  return mazeLoadText(maze, text);
+}
+
+/*
+ * Write the maze as text into a buffer of at least MAZE_TEXT_SIZE
+ * characters. Walls that are not known are shown as absent.
+ */
+void mazeToText(const maze_t *maze, char *text) {
+  int x;
+  int y;
+  for (y = MAZE_WIDTH - 1; y >= 0; y--) {
+    for (x = 0; x < MAZE_WIDTH; x++) {
+      text += sprintf(text, "o%s", mazeHasWall(maze, CELL(x, y), NORTH) ? "---" : "   ");
+    }
+    text += sprintf(text, "o\n");
+    for (x = 0; x < MAZE_WIDTH; x++) {
+      text += sprintf(text, "%c   ", mazeHasWall(maze, CELL(x, y), WEST) ? '|' : ' ');
+    }
+    text += sprintf(text, "%c\n", mazeHasWall(maze, CELL(MAZE_WIDTH - 1, y), EAST) ? '|' : ' ');
+  }
+  for (x = 0; x < MAZE_WIDTH; x++) {
+    text += sprintf(text, "o%s", mazeHasWall(maze, CELL(x, 0), SOUTH) ? "---" : "   ");
+  }
+  sprintf(text, "o\n");
+}
+
+static uint32_t nextRandom(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static int isStartWall(int cell, int heading) {
+  return (cell == START_CELL && heading == EAST) || (cell == CELL(1, 0) && heading == WEST);
+}
+
+/*
+ * Generate a random maze that is the same for the same seed. A depth
+ * first search carves a perfect maze and then a few extra walls are
+ * removed so that there is more than one route to the goal. The four
+ * goal cells are always open to each other and the start cell always
+ * has its east wall.
+ */
+void mazeGenerate(maze_t *maze, uint32_t seed) {
+  uint8_t stack[MAZE_CELLS];
+  uint8_t visited[MAZE_CELLS];
+  int top = 0;
+  int i;
+  uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+  if (rng == 0) {
+    rng = 1;
+  }
+  memset(maze->cells, 0xFF, sizeof (maze->cells));
+  memset(visited, 0, sizeof (visited));
+  stack[top++] = START_CELL;
+  visited[START_CELL] = 1;
+  while (top > 0) {
+    int cell = stack[top - 1];
+    int options[4];
+    int count = 0;
+    int h;
+    for (h = 0; h < 4; h++) {
+      int next = mazeNeighbour(cell, h);
+      if (next >= 0 && !visited[next] && !isStartWall(cell, h)) {
+        options[count++] = h;
+      }
+    }
+    if (count == 0) {
+      top--;
+      continue;
+    }
+    h = options[nextRandom(&rng) % count];
+    mazeSetWall(maze, cell, h, 0);
+    cell = mazeNeighbour(cell, h);
+    visited[cell] = 1;
+    stack[top++] = cell;
+  }
+  for (i = 0; i < MAZE_CELLS / 8; i++) {
+    int cell = nextRandom(&rng) % MAZE_CELLS;
+    int h = nextRandom(&rng) % 4;
+    if (mazeNeighbour(cell, h) >= 0 && !isStartWall(cell, h)) {
+      mazeSetWall(maze, cell, h, 0);
+    }
+  }
+  mazeSetWall(maze, CELL(MAZE_WIDTH / 2 - 1, MAZE_WIDTH / 2 - 1), NORTH, 0);
+  mazeSetWall(maze, CELL(MAZE_WIDTH / 2 - 1, MAZE_WIDTH / 2 - 1), EAST, 0);
+  mazeSetWall(maze, CELL(MAZE_WIDTH / 2, MAZE_WIDTH / 2), SOUTH, 0);
+  mazeSetWall(maze, CELL(MAZE_WIDTH / 2, MAZE_WIDTH / 2), WEST, 0);
+}
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef MAZE_H
+#define	MAZE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+  /*
+   * A classic 16x16 micromouse maze. Cells are numbered column by column
+   * so that cell = x * MAZE_WIDTH + y with the start cell at (0,0) in the
+   * south-west corner. The mouse always leaves the start cell heading north.
+   *
+   * Each cell holds one byte:
+   * B3:0 => wall present, one bit per heading (NORTH..WEST)
+   * B7:4 => wall state known, same bit order
+   *
+   * A wall that has not been seen is treated as absent by the solvers so
+   * that the maze being explored is always optimistic.
+   */
+
+#define MAZE_WIDTH  16
+#define MAZE_CELLS  (MAZE_WIDTH * MAZE_WIDTH)
+#define MAZE_TEXT_SIZE ((4 * MAZE_WIDTH + 2) * (2 * MAZE_WIDTH + 1) + 1)
+
+#define CELL(x, y)  ((uint8_t)((x) * MAZE_WIDTH + (y)))
+#define CELL_X(c)   ((c) / MAZE_WIDTH)
+#define CELL_Y(c)   ((c) % MAZE_WIDTH)
+
+#define NORTH       (0)
+#define EAST        (1)
+#define SOUTH       (2)
+#define WEST        (3)
+
+#define WALL_BIT(h)  (1 << (h))
+#define KNOWN_BIT(h) (0x10 << (h))
+
+#define START_CELL  CELL(0, 0)
+
+  typedef struct {
+    uint8_t cells[MAZE_CELLS];
+  } maze_t;
+
+  extern const int8_t mazeDelta[4];
+
+  static inline int mazeHasWall(const maze_t *maze, int cell, int heading) {
+    return (maze->cells[cell] & WALL_BIT(heading)) != 0;
+  }
+
+  static inline int mazeIsKnown(const maze_t *maze, int cell, int heading) {
+    return (maze->cells[cell] & KNOWN_BIT(heading)) != 0;
+  }
+
+  static inline int mazeIsGoal(int cell) {
+    int x = CELL_X(cell);
+    int y = CELL_Y(cell);
+    return (x == MAZE_WIDTH / 2 - 1 || x == MAZE_WIDTH / 2) && (y == MAZE_WIDTH / 2 - 1 || y == MAZE_WIDTH / 2);
+  }
+
+  int mazeNeighbour(int cell, int heading);
+  void mazeClear(maze_t *maze);
+  void mazeInitExplore(maze_t *maze);
+  int mazeSetWall(maze_t *maze, int cell, int heading, int present);
+  int mazeLoadText(maze_t *maze, const char *text);
+  int mazeLoadFile(maze_t *maze, const char *filename);
+  void mazeToText(const maze_t *maze, char *text);
+  void mazeGenerate(maze_t *maze, uint32_t seed);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MAZE_H */
+
@@ -0,0 +1,293 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "pose.h"
+#include "peephole.h"
+
+/*
+ * A peephole pass over a generated command list. The generator commits to
+ * a command as soon as it is unambiguous so it never looks back to see
+ * whether a different sequence would have been faster. This pass slides
+ * a small window along the list and offers each rule a chance to replace
+ * the commands at the start of the window with an equivalent sequence.
+ *
+ * A replacement is only made if the time model says it is faster, or it
+ * takes the same time with fewer commands. Passes are repeated until
+ * nothing changes since one rewrite can expose another.
+ *
+ * Every rule must leave the mouse in the same place with the same heading
+ * as the commands it replaced. The test harness checks that for every
+ * window a rule can match.
+ */
+
+#define IS_FWD(c)   ((c) > CMD_STOP && (c) <= CMD_SQUARES)
+#define IS_DIA(c)   ((c) >= DIA0 && (c) < CMD_TURN)
+#define IS_IP(c)    ((c) >= IP45R && (c) <= IP180L)
+#define IS_SS90(c)  ((c) == SS90SR || (c) == SS90SL)
+#define DIR(c)      ((c) & CMD_LEFT)
+
+/*
+ * DIA0 goes nowhere.
+ */
+static int dropZeroDiagonal(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  (void) available;
+  (void) out;
+  if (in[0] != DIA0) {
+    return 0;
+  }
+  *outCount = 0;
+  return 1;
+}
+
+/*
+ * FWDa FWDb => FWDa+b
+ */
+static int mergeStraights(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 2 || !IS_FWD(in[0]) || !IS_FWD(in[1]) || in[0] + in[1] > CMD_SQUARES) {
+    return 0;
+  }
+  out[0] = in[0] + in[1];
+  *outCount = 1;
+  return 2;
+}
+
+/*
+ * DIAa DIAb => DIAa+b
+ */
+static int mergeDiagonals(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 2 || !IS_DIA(in[0]) || !IS_DIA(in[1]) || (in[0] - DIA0) + (in[1] - DIA0) > CMD_SQUARES) {
+    return 0;
+  }
+  out[0] = in[0] + in[1] - DIA0;
+  *outCount = 1;
+  return 2;
+}
+
+/*
+ * Two in-place turns become one, or none if they cancel.
+ */
+static int composeInPlace(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  int turn;
+  if (available < 2 || !IS_IP(in[0]) || !IS_IP(in[1])) {
+    return 0;
+  }
+  turn = turnGeometry[in[0] - IP45R].turn + turnGeometry[in[1] - IP45R].turn;
+  if (turn > 4) {
+    turn -= 8;
+  } else if (turn < -4) {
+    turn += 8;
+  }
+  *outCount = 0;
+  if (turn > 0) {
+    out[(*outCount)++] = IP45R + 2 * (turn - 1);
+  } else if (turn < 0) {
+    out[(*outCount)++] = IP45L + 2 * (-turn - 1);
+  }
+  return 2;
+}
+
+/*
+ * FWDa IP90x FWDb => FWDa SS90Sx FWDb
+ * There must be a straight either side for the mouse to be moving.
+ */
+static int inPlaceToSmooth(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 3 || !IS_FWD(in[0]) || (in[1] != IP90R && in[1] != IP90L) || !IS_FWD(in[2])) {
+    return 0;
+  }
+  out[0] = in[0];
+  out[1] = SS90SR + DIR(in[1]);
+  out[2] = in[2];
+  *outCount = 3;
+  return 3;
+}
+
+/*
+ * SD45x DIA2 DS45y => SS90Sx FWD1 SS90Sy where y is the other way to x
+ */
+static int zigzagToOrtho(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 3 || (in[0] != SD45R && in[0] != SD45L) || in[1] != DIA2
+          || in[2] != DS45R + (DIR(in[0]) ^ CMD_LEFT)) {
+    return 0;
+  }
+  out[0] = SS90SR + DIR(in[0]);
+  out[1] = FWD1;
+  out[2] = SS90SR + DIR(in[2]);
+  *outCount = 3;
+  return 3;
+}
+
+/*
+ * SS90Sx FWD1 SS90Sy => SD45x DIA2 DS45y where y is the other way to x
+ */
+static int orthoToZigzag(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 3 || !IS_SS90(in[0]) || in[1] != FWD1 || in[2] != SS90SR + (DIR(in[0]) ^ CMD_LEFT)) {
+    return 0;
+  }
+  out[0] = SD45R + DIR(in[0]);
+  out[1] = DIA2;
+  out[2] = DS45R + DIR(in[2]);
+  *outCount = 3;
+  return 3;
+}
+
+/*
+ * SS90Sx FWD1 SS90Sx => SS180x
+ */
+static int pairToU(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  if (available < 3 || !IS_SS90(in[0]) || in[1] != FWD1 || in[2] != in[0]) {
+    return 0;
+  }
+  out[0] = SS180R + DIR(in[0]);
+  *outCount = 1;
+  return 3;
+}
+
+/*
+ * SS180x => SS90Sx FWD1 SS90Sx
+ */
+static int uToPair(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  (void) available;
+  if (in[0] != SS180R && in[0] != SS180L) {
+    return 0;
+  }
+  out[0] = SS90SR + DIR(in[0]);
+  out[1] = FWD1;
+  out[2] = SS90SR + DIR(in[0]);
+  *outCount = 3;
+  return 1;
+}
+
+/*
+ * SDxx DIA2 DSyy => SDxx_DSyy where y is the other way to x, and the same
+ * for DD90 at either end
+ */
+static int fuseIntegrated(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  COMMAND fused;
+  if (available < 3) {
+    return 0;
+  }
+  fused = integrateTurns(in[0], in[1], in[2]);
+  if (fused == CMD_STOP) {
+    return 0;
+  }
+  out[0] = fused;
+  *outCount = 1;
+  return 3;
+}
+
+/*
+ * SDxx_DSyy => SDxx DIA2 DSyy
+ */
+static int splitIntegrated(const COMMAND *in, int available, COMMAND *out, int *outCount) {
+  (void) available;
+  *outCount = integratedParts(in[0], out);
+  return *outCount != 0;
+}
+
+/*
+ * FWD0 has the same value as CMD_STOP so a zero length orthogonal
+ * straight can never appear inside a list and needs no rule.
+ */
+const peepholeRule_t peepholeRules[] = {
+  {"dropZeroDiagonal", 0, dropZeroDiagonal},
+  {"mergeStraights", 0, mergeStraights},
+  {"mergeDiagonals", CAP_DIAGONAL, mergeDiagonals},
+  {"composeInPlace", CAP_IN_PLACE, composeInPlace},
+  {"inPlaceToSmooth", CAP_SMOOTH_90, inPlaceToSmooth},
+  {"zigzagToOrtho", CAP_SMOOTH_90, zigzagToOrtho},
+  {"orthoToZigzag", CAP_DIAGONAL, orthoToZigzag},
+  {"pairToU", CAP_SMOOTH_180, pairToU},
+  {"uToPair", CAP_SMOOTH_90, uToPair},
+  {"fuseIntegrated", CAP_INTEGRATED, fuseIntegrated},
+  {"splitIntegrated", CAP_DIAGONAL, splitIntegrated},
+};
+
+const int peepholeRuleCount = sizeof (peepholeRules) / sizeof (peepholeRule_t);
+
+/*
+ * Optimise a CMD_STOP terminated list in place using only the rules whose
+ * output the mouse can drive. cost and context give the time model used
+ * to decide whether a rewrite is worthwhile.
+ *
+ * The list must have room for COMMAND_LIST_SIZE commands. A rewrite that
+ * would make it longer than that is not made. If the list gets shorter
+ * the space it used to occupy is filled with CMD_STOP so nothing stale is
+ * left behind.
+ *
+ * Returns the number of rewrites made.
+ */
+int peepholeOptimise(COMMAND *list, unsigned capabilities, commandCostFn cost, const void *context) {
+  COMMAND buffer[COMMAND_LIST_SIZE];
+  int rewrites = 0;
+  int length = 0;
+  int pass;
+  while (length < COMMAND_LIST_SIZE - 1 && list[length] != CMD_STOP) {
+    length++;
+  }
+  for (pass = 0; pass < PEEPHOLE_MAX_PASSES; pass++) {
+    int changed = 0;
+    int i = 0;
+    int o = 0;
+    while (i < length) {
+      COMMAND out[PEEPHOLE_MAX_OUT];
+      int matched = 0;
+      int r;
+      for (r = 0; r < peepholeRuleCount && !matched; r++) {
+        const peepholeRule_t *rule = &peepholeRules[r];
+        int outCount;
+        int w;
+        if ((rule->capabilities & ~capabilities) != 0) {
+          continue;
+        }
+        w = rule->match(&list[i], length - i, out, &outCount);
+        if (w > 0 && o + outCount + (length - i - w) < COMMAND_LIST_SIZE) {
+          float before = listCost(cost, context, &list[i], w);
+          float after = listCost(cost, context, out, outCount);
+          if (after < before || (after == before && outCount < w)) {
+            memcpy(&buffer[o], out, outCount);
+            o += outCount;
+            i += w;
+            matched = 1;
+          }
+        }
+      }
+      if (matched) {
+        changed++;
+      } else {
+        buffer[o++] = list[i++];
+      }
+    }
+    if (o < length) {
+      memset(&list[o], CMD_STOP, length - o);
+    }
+    memcpy(list, buffer, o);
+    list[o] = CMD_STOP;
+    length = o;
+    rewrites += changed;
+    if (!changed) {
+      break;
+    }
+  }
+  return rewrites;
+}
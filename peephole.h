@@ -0,0 +1,68 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef PEEPHOLE_H
+#define	PEEPHOLE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "commands.h"
+#include "timemodel.h"
+
+#define PEEPHOLE_MAX_OUT     (4)
+#define PEEPHOLE_MAX_PASSES  (8)
+
+  /*
+   * Room for the longest replacements, an SS180 as a pair of SS90s and an
+   * integrated turn split into its parts.
+   */
+  typedef char peepholeMaxOutCheck_t[PEEPHOLE_MAX_OUT >= 3 && PEEPHOLE_MAX_OUT >= INTEGRATED_PARTS ? 1 : -1];
+
+  /*
+   * A rule looks at the start of a window of commands. If the window
+   * matches it writes the replacement into out, sets outCount and returns
+   * the number of commands it would replace. It returns zero if there is
+   * no match. Rules must never see CMD_STOP inside the window.
+   *
+   * capabilities lists everything the mouse must be able to do to drive
+   * the replacement.
+   */
+  typedef struct {
+    const char *name;
+    unsigned capabilities;
+    int (*match)(const COMMAND *in, int available, COMMAND *out, int *outCount);
+  } peepholeRule_t;
+
+  extern const peepholeRule_t peepholeRules[];
+  extern const int peepholeRuleCount;
+
+  int peepholeOptimise(COMMAND *list, unsigned capabilities, commandCostFn cost, const void *context);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PEEPHOLE_H */
+
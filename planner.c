@@ -0,0 +1,243 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "planner.h"
+
+/*
+ * D* Lite on the maze graph. Every open wall is an edge of cost one and
+ * a wall that is present has infinite cost. The goal cells are the
+ * sources of the search and the mouse is the target, so the heuristic is
+ * the manhattan distance to the mouse. When the mouse moves, the heuristic
+ * of every queued key changes by at most the distance moved and that is
+ * accumulated in km rather than re-keying the whole queue.
+ *
+ * The queue is a binary heap of cell numbers with an index so that keys
+ * can be changed and cells removed without searching. Nothing is
+ * allocated so the planner can live in static storage on the mouse.
+ *
+ * Refer to Koenig and Likhachev, "D* Lite", AAAI 2002 for the algorithm.
+ */
+
+static int heuristic(int a, int b) {
+  int dx = CELL_X(a) - CELL_X(b);
+  int dy = CELL_Y(a) - CELL_Y(b);
+  return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+}
+
+static uint32_t calculateKey(const planner_t *p, int cell) {
+  uint32_t m = p->g[cell] < p->rhs[cell] ? p->g[cell] : p->rhs[cell];
+  uint32_t k1 = DIST_INF;
+  if (m != DIST_INF) {
+    k1 = m + heuristic(p->start, cell) + p->km;
+    if (k1 > DIST_INF) {
+      k1 = DIST_INF;
+    }
+  }
+  return (k1 << 16) | m;
+}
+
+static void heapSwap(planner_t *p, int i, int j) {
+  uint8_t a = p->heap[i];
+  uint8_t b = p->heap[j];
+  p->heap[i] = b;
+  p->heap[j] = a;
+  p->heapIndex[b] = i;
+  p->heapIndex[a] = j;
+}
+
+static void heapUp(planner_t *p, int i) {
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (p->key[p->heap[parent]] <= p->key[p->heap[i]]) {
+      break;
+    }
+    heapSwap(p, i, parent);
+    i = parent;
+  }
+}
+
+static void heapDown(planner_t *p, int i) {
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= p->heapSize) {
+      break;
+    }
+    if (child + 1 < p->heapSize && p->key[p->heap[child + 1]] < p->key[p->heap[child]]) {
+      child++;
+    }
+    if (p->key[p->heap[i]] <= p->key[p->heap[child]]) {
+      break;
+    }
+    heapSwap(p, i, child);
+    i = child;
+  }
+}
+
+static void heapSet(planner_t *p, int cell, uint32_t key) {
+  int i = p->heapIndex[cell];
+  p->key[cell] = key;
+  if (i < 0) {
+    i = p->heapSize++;
+    p->heap[i] = cell;
+    p->heapIndex[cell] = i;
+  }
+  heapUp(p, i);
+  heapDown(p, p->heapIndex[cell]);
+}
+
+static void heapRemove(planner_t *p, int cell) {
+  int i = p->heapIndex[cell];
+  int last = p->heapSize - 1;
+  if (i < 0) {
+    return;
+  }
+  if (i != last) {
+    heapSwap(p, i, last);
+  }
+  p->heapSize--;
+  p->heapIndex[cell] = -1;
+  if (i != last) {
+    uint8_t moved = p->heap[i];
+    heapUp(p, i);
+    heapDown(p, p->heapIndex[moved]);
+  }
+}
+
+static void updateVertex(planner_t *p, int cell) {
+  if (!mazeIsGoal(cell)) {
+    uint16_t best = DIST_INF;
+    int h;
+    for (h = 0; h < 4; h++) {
+      if (!mazeHasWall(p->maze, cell, h)) {
+        uint16_t g = p->g[cell + mazeDelta[h]];
+        if (g != DIST_INF && g + 1 < best) {
+          best = g + 1;
+        }
+      }
+    }
+    p->rhs[cell] = best;
+  }
+  if (p->g[cell] != p->rhs[cell]) {
+    heapSet(p, cell, calculateKey(p, cell));
+  } else {
+    heapRemove(p, cell);
+  }
+}
+
+/*
+ * Prepare the planner for a new search towards the goal with the mouse
+ * in the given cell. The maze is referenced, not copied, so the caller
+ * updates it and then tells the planner which walls changed.
+ * There is no expansion budget until one is set after this call.
+ */
+void plannerInit(planner_t *p, const maze_t *maze, int start) {
+  int cell;
+  p->maze = maze;
+  p->heapSize = 0;
+  p->km = 0;
+  p->budget = 0;
+  p->start = start;
+  p->last = start;
+  p->expansions = 0;
+  p->maxExpansions = 0;
+  for (cell = 0; cell < MAZE_CELLS; cell++) {
+    p->g[cell] = DIST_INF;
+    p->rhs[cell] = mazeIsGoal(cell) ? 0 : DIST_INF;
+    p->heapIndex[cell] = -1;
+  }
+  for (cell = 0; cell < MAZE_CELLS; cell++) {
+    if (mazeIsGoal(cell)) {
+      heapSet(p, cell, calculateKey(p, cell));
+    }
+  }
+}
+
+/*
+ * The mouse has moved. Queued keys are now optimistic by at most the
+ * distance moved so that is added to km instead of re-keying the queue.
+ */
+void plannerMoveTo(planner_t *p, int cell) {
+  p->km += heuristic(p->last, cell);
+  p->last = cell;
+  p->start = cell;
+}
+
+/*
+ * Call after a wall has been changed in the maze. Both cells either side
+ * of the wall may have a new distance.
+ */
+void plannerWallChanged(planner_t *p, int cell, int heading) {
+  int next = mazeNeighbour(cell, heading);
+  updateVertex(p, cell);
+  if (next >= 0) {
+    updateVertex(p, next);
+  }
+}
+
+/*
+ * Repair the distances until the mouse cell is consistent. If a budget
+ * is set and runs out, PLAN_INCOMPLETE is returned and the next call
+ * carries on from where this one stopped, so the time taken per control
+ * cycle can be bounded.
+ *
+ * Returns PLAN_DONE when g[] can be used to build a route.
+ */
+int plannerUpdate(planner_t *p) {
+  int s = p->start;
+  p->expansions = 0;
+  while (p->heapSize > 0 && (p->key[p->heap[0]] < calculateKey(p, s) || p->rhs[s] != p->g[s])) {
+    int u = p->heap[0];
+    uint32_t oldKey = p->key[u];
+    uint32_t newKey = calculateKey(p, u);
+    int h;
+    if (p->budget > 0 && p->expansions >= p->budget) {
+      p->maxExpansions = p->budget;
+      return PLAN_INCOMPLETE;
+    }
+    p->expansions++;
+    if (oldKey < newKey) {
+      heapSet(p, u, newKey);
+    } else if (p->g[u] > p->rhs[u]) {
+      p->g[u] = p->rhs[u];
+      heapRemove(p, u);
+      for (h = 0; h < 4; h++) {
+        if (!mazeHasWall(p->maze, u, h)) {
+          updateVertex(p, u + mazeDelta[h]);
+        }
+      }
+    } else {
+      p->g[u] = DIST_INF;
+      updateVertex(p, u);
+      for (h = 0; h < 4; h++) {
+        if (!mazeHasWall(p->maze, u, h)) {
+          updateVertex(p, u + mazeDelta[h]);
+        }
+      }
+    }
+  }
+  if (p->expansions > p->maxExpansions) {
+    p->maxExpansions = p->expansions;
+  }
+  return p->rhs[s] == DIST_INF ? PLAN_NO_ROUTE : PLAN_DONE;
+}
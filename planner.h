@@ -0,0 +1,76 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef PLANNER_H
+#define	PLANNER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "maze.h"
+#include "flood.h"
+
+  /*
+   * An incremental planner in the style of D* Lite. It keeps its
+   * distance estimates and priority queue between calls so that when a
+   * few walls are discovered only the cells whose distance to the goal
+   * has changed are expanded again.
+   *
+   * The search runs backwards from the goal so g[] holds the same
+   * distances that floodMaze() would produce for every cell the search
+   * has settled, and can be handed straight to makeRoute().
+   */
+
+#define PLAN_DONE       (0)
+#define PLAN_INCOMPLETE (1)
+#define PLAN_NO_ROUTE   (2)
+
+  typedef struct {
+    const maze_t *maze;
+    uint16_t g[MAZE_CELLS];
+    uint16_t rhs[MAZE_CELLS];
+    uint32_t key[MAZE_CELLS];      // (k1 << 16) | k2 for cells in the queue
+    uint8_t heap[MAZE_CELLS];
+    int16_t heapIndex[MAZE_CELLS]; // -1 if the cell is not in the queue
+    int heapSize;
+    uint16_t km;
+    uint8_t start;
+    uint8_t last;
+    int budget;                    // max expansions per call, 0 for no limit
+    int expansions;                // expansions in the most recent call
+    int maxExpansions;             // worst case since the planner was reset
+  } planner_t;
+
+  void plannerInit(planner_t *planner, const maze_t *maze, int start);
+  void plannerMoveTo(planner_t *planner, int cell);
+  void plannerWallChanged(planner_t *planner, int cell, int heading);
+  int plannerUpdate(planner_t *planner);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PLANNER_H */
+
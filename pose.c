@@ -0,0 +1,159 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include "pose.h"
+
+/*
+ * Offsets are for the canonical entry heading and are rotated to suit the
+ * actual heading. See pose.h for the units.
+ */
+const turnGeometry_t turnGeometry[TURN_COUNT] = {
+  {+1, 0, 0, 0}, // IP45R
+  {-1, 0, 0, 0}, // IP45L
+  {+2, 0, 0, 0}, // IP90R
+  {-2, 0, 0, 0}, // IP90L
+  {+3, 0, 0, 0}, // IP135R
+  {-3, 0, 0, 0}, // IP135L
+  {+4, 0, 0, 0}, // IP180R
+  {-4, 0, 0, 0}, // IP180L
+  {+2, 0, 0, 0}, // SS90SR
+  {-2, 0, 0, 0}, // SS90SL
+  {+2, 0, 0, 0}, // SS90FR
+  {-2, 0, 0, 0}, // SS90FL
+  {+4, 2, 0, 0}, // SS180R ends one cell to the right
+  {-4, -2, 0, 0}, // SS180L
+  {+1, 0, -1, 0}, // SD45R the diagonal starts at the cell edge
+  {-1, 0, -1, 0}, // SD45L
+  {+3, 1, 0, 0}, // SD135R
+  {-3, -1, 0, 0}, // SD135L
+  {+1, -1, 0, 1}, // DS45R the diagonal ends at the cell edge
+  {-1, 0, -1, 1}, // DS45L
+  {+3, 1, 0, 1}, // DS135R
+  {-3, 0, 1, 1}, // DS135L
+  {+2, 0, 0, 1}, // DD90R
+  {-2, 0, 0, 1}, // DD90L
+  {+2, 0, 0, 0}, // SS90ER
+  {-2, 0, 0, 0}, // SS90EL
+};
+
+const int8_t headingDX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+const int8_t headingDY[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+
+void poseStart(pose_t *pose) {
+  pose->x = 0;
+  pose->y = 0;
+  pose->heading = 0;
+}
+
+/*
+ * Move the pose by one command. Returns 0 on success or -1 if the command
+ * cannot be driven from this heading, such as a diagonal straight while
+ * the mouse is orthogonal, or is not a movement command at all.
+ */
+int poseApply(pose_t *pose, COMMAND cmd) {
+  int h = pose->heading;
+  if (cmd <= CMD_SQUARES) {
+    if (h & 1) {
+      return -1;
+    }
+    pose->x += 2 * headingDX[h] * (cmd - FWD0);
+    pose->y += 2 * headingDY[h] * (cmd - FWD0);
+  } else if (cmd < CMD_TURN) {
+    if (!(h & 1)) {
+      return -1;
+    }
+    pose->x += headingDX[h] * (cmd - DIA0);
+    pose->y += headingDY[h] * (cmd - DIA0);
+  } else if (cmd <= SS90EL) {
+    const turnGeometry_t *g = &turnGeometry[cmd - IP45R];
+    int dx = g->dx;
+    int dy = g->dy;
+    int q;
+    if (cmd >= SS90SR && (h & 1) != g->entry) {
+      return -1;
+    }
+    for (q = h >> 1; q > 0; q--) {
+      int t = dx;
+      dx = dy;
+      dy = -t;
+    }
+    pose->x += dx;
+    pose->y += dy;
+    pose->heading = (h + g->turn) & 7;
+  } else {
+    COMMAND parts[INTEGRATED_PARTS];
+    int n = integratedParts(cmd, parts);
+    int i;
+    if (n == 0) {
+      return -1;
+    }
+    for (i = 0; i < n; i++) {
+      if (poseApply(pose, parts[i]) != 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * Drive at most n commands from a list, stopping at CMD_STOP.
+ * Returns -1 if every command could be driven, or the index of the first
+ * one that could not, in the same way as compareCommands().
+ */
+int poseRun(pose_t *pose, const COMMAND *list, int n) {
+  int i;
+  for (i = 0; i < n && list[i] != CMD_STOP; i++) {
+    if (poseApply(pose, list[i]) != 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int poseEqual(const pose_t *a, const pose_t *b) {
+  return a->x == b->x && a->y == b->y && a->heading == b->heading;
+}
+
+/*
+ * Walk a route string one cell at a time. The pose ends in the centre of
+ * the goal cell, heading the way the mouse entered it. This is what the
+ * commands generated from the route should reproduce.
+ * Returns -1 if the route is valid or the index of the first character
+ * that is not one of FLRS.
+ */
+int poseFollowRoute(pose_t *pose, const char *route) {
+  int i;
+  for (i = 0; route[i] != 'S'; i++) {
+    if (route[i] == 'R') {
+      pose->heading = (pose->heading + 2) & 7;
+    } else if (route[i] == 'L') {
+      pose->heading = (pose->heading + 6) & 7;
+    } else if (route[i] != 'F') {
+      return i;
+    }
+    pose->x += 2 * headingDX[pose->heading];
+    pose->y += 2 * headingDY[pose->heading];
+  }
+  return -1;
+}
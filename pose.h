@@ -0,0 +1,81 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef POSE_H
+#define	POSE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+
+  /*
+   * The nominal geometry of the command set. Positions are in half cells
+   * with the mouse starting at (0,0) in the centre of the start cell so
+   * that cell centres have even coordinates. Headings are in 45 degree
+   * steps clockwise from north:
+   *
+   *   0 N   1 NE   2 E   3 SE   4 S   5 SW   6 W   7 NW
+   *
+   * FWDn moves n whole cells and DIAn moves n half diagonals, which is the
+   * distance from one cell edge to the next along a diagonal.
+   *
+   * Turns are reference points rather than curves. Orthogonal turns
+   * happen at the cell centre and the 45 and 135 degree turns include the
+   * offset between the cell centre and the point where the diagonal
+   * starts or ends. With these rules the pose after a command list is the
+   * centre of the last cell of the route it came from, which is what
+   * makes it possible to check that two lists drive the same path.
+   */
+
+  typedef struct {
+    int16_t x;
+    int16_t y;
+    uint8_t heading;
+  } pose_t;
+
+  typedef struct {
+    int8_t turn;    // change of heading in 45 degree steps, right is positive
+    int8_t dx;      // offset when entering heading north (or north east for
+    int8_t dy;      // turns that start on a diagonal)
+    uint8_t entry;  // 0 for orthogonal entry, 1 for diagonal entry
+  } turnGeometry_t;
+
+  extern const turnGeometry_t turnGeometry[TURN_COUNT];
+  extern const int8_t headingDX[8];
+  extern const int8_t headingDY[8];
+
+  void poseStart(pose_t *pose);
+  int poseApply(pose_t *pose, COMMAND cmd);
+  int poseRun(pose_t *pose, const COMMAND *list, int n);
+  int poseEqual(const pose_t *a, const pose_t *b);
+  int poseFollowRoute(pose_t *pose, const char *route);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* POSE_H */
+
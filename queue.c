@@ -0,0 +1,90 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include "queue.h"
+
+/*
+ * The capacity is rounded up to a power of two, at most QUEUE_MAX.
+ * Returns the capacity used.
+ */
+int queueInit(queue_t *queue, size_t capacity) {
+  size_t size = 1;
+  size_t i;
+  while (size < capacity && size < QUEUE_MAX) {
+    size <<= 1;
+  }
+  queue->mask = size - 1;
+  for (i = 0; i < size; i++) {
+    atomic_init(&queue->slots[i].sequence, i);
+    queue->slots[i].item = NULL;
+  }
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  return (int) size;
+}
+
+/*
+ * Returns 1 if the item was added or 0 if the queue is full.
+ */
+int queuePush(queue_t *queue, void *item) {
+  size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  for (;;) {
+    queueSlot_t *slot = &queue->slots[pos & queue->mask];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) pos;
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+        slot->item = item;
+        atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0;
+    } else {
+      pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    }
+  }
+}
+
+/*
+ * Returns 1 and the oldest item or 0 if the queue is empty.
+ */
+int queuePop(queue_t *queue, void **item) {
+  size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  for (;;) {
+    queueSlot_t *slot = &queue->slots[pos & queue->mask];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) (pos + 1);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+        *item = slot->item;
+        atomic_store_explicit(&slot->sequence, pos + queue->mask + 1, memory_order_release);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0;
+    } else {
+      pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    }
+  }
+}
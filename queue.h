@@ -0,0 +1,76 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef QUEUE_H
+#define	QUEUE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef __cplusplus
+#include <stdatomic.h>
+#endif
+#include <stddef.h>
+
+  /*
+   * A bounded lock-free queue of pointers that any number of threads can
+   * push to and pop from. Every slot has a sequence number that says
+   * whether it is ready to be written or read on the current lap, so a
+   * push or pop is one compare and swap on the shared position and no
+   * thread ever waits on another while holding anything.
+   *
+   * Push and pop never block. They return 0 when the queue is full or
+   * empty and the caller decides how to wait.
+   *
+   * The queue is built on C11 atomics, which C++ cannot name, so from C++
+   * queue_t is an opaque type that can only be used through a pointer.
+   */
+
+#define QUEUE_MAX (1024)
+
+  typedef struct queue_s queue_t;
+
+#ifndef __cplusplus
+  typedef struct {
+    atomic_size_t sequence;
+    void *item;
+  } queueSlot_t;
+
+  struct queue_s {
+    size_t mask;
+    _Alignas(64) atomic_size_t head;  // next slot to read
+    _Alignas(64) atomic_size_t tail;  // next slot to write
+    _Alignas(64) queueSlot_t slots[QUEUE_MAX];
+  };
+#endif
+
+  int queueInit(queue_t *queue, size_t capacity);
+  int queuePush(queue_t *queue, void *item);
+  int queuePop(queue_t *queue, void **item);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* QUEUE_H */
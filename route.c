@@ -0,0 +1,81 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "route.h"
+
+static const char moveChar[4] = {'F', 'L', 'R', '?'};
+
+/*
+ * Pack a route string up to its S or the end of the string.
+ * Returns -1 on success or the index of the first character that is not
+ * one of FLRS or does not fit, in the same way as compareCommands(). The
+ * moves before it are left packed and the route is not terminated.
+ */
+int routePack(packedRoute_t *route, const char *s) {
+  int i;
+  memset(route->moves, 0, sizeof (route->moves));
+  route->length = 0;
+  for (i = 0; s[i] != 'S'; i++) {
+    uint64_t move;
+    if (s[i] == 'F') {
+      move = 0;
+    } else if (s[i] == 'L') {
+      move = 1;
+    } else if (s[i] == 'R') {
+      move = 2;
+    } else if (s[i] == 0) {
+      return -1;
+    } else {
+      return i;
+    }
+    if (i == PACKED_ROUTE_MOVES) {
+      return i;
+    }
+    route->moves[i / 32] |= move << (2 * (i % 32));
+    route->length = (uint16_t) (i + 1);
+  }
+  route->length |= ROUTE_TERMINATED;
+  return -1;
+}
+
+/*
+ * Write a packed route out as a zero terminated string with an S if it
+ * ends in the goal. Returns the length of the string or -1 if it does
+ * not fit in size characters.
+ */
+int routeUnpack(const packedRoute_t *route, char *s, int size) {
+  int length = routeLength(route);
+  int i;
+  if (length + routeTerminated(route) + 1 > size) {
+    return -1;
+  }
+  for (i = 0; i < length; i++) {
+    s[i] = moveChar[routeMove(route, i)];
+  }
+  if (routeTerminated(route)) {
+    s[length++] = 'S';
+  }
+  s[length] = 0;
+  return length;
+}
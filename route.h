@@ -0,0 +1,76 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef ROUTE_H
+#define	ROUTE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+  /*
+   * A route packed two bits per move, 32 moves to each 64 bit word with
+   * the first move in the lowest bits:
+   *
+   *   0 F   1 L   2 R   3 unused
+   *
+   * There is no S. The number of moves is kept in the low bits of length
+   * and the top bit says whether the route ends in the goal, which is
+   * what the S would have said. A route that does not end in the goal is
+   * generated in the same way as a string that stops without an S.
+   *
+   * A full route takes 72 bytes instead of 256.
+   */
+
+#define PACKED_ROUTE_MOVES  (256)
+#define PACKED_ROUTE_WORDS  (PACKED_ROUTE_MOVES / 32)
+#define ROUTE_TERMINATED    (0x8000)
+#define ROUTE_LENGTH_MASK   (0x7FFF)
+
+  typedef struct {
+    uint64_t moves[PACKED_ROUTE_WORDS];
+    uint16_t length;
+  } packedRoute_t;
+
+  static inline int routeLength(const packedRoute_t *route) {
+    return route->length & ROUTE_LENGTH_MASK;
+  }
+
+  static inline int routeTerminated(const packedRoute_t *route) {
+    return (route->length & ROUTE_TERMINATED) != 0;
+  }
+
+  static inline int routeMove(const packedRoute_t *route, int i) {
+    return (int) (route->moves[i / 32] >> (2 * (i % 32))) & 3;
+  }
+
+  int routePack(packedRoute_t *route, const char *s);
+  int routeUnpack(const packedRoute_t *route, char *s, int size);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ROUTE_H */
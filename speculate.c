@@ -0,0 +1,413 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "flood.h"
+#include "makepath.h"
+#include "speculate.h"
+
+#ifndef CMD_THREADS
+#error "the speculation thread generates paths alongside the explorer and needs -DCMD_THREADS"
+#endif
+
+/*
+ * Room for the route and the command list of an average node when the
+ * memory cap is shared out between nodes.
+ */
+#define SPEC_NODE_ROOM (96)
+
+static void applyOutcome(maze_t *maze, const specNode_t *node) {
+  int h;
+  for (h = 0; h < 4; h++) {
+    if (node->sensed & WALL_BIT(h)) {
+      mazeSetWall(maze, node->cell, h, (node->walls & WALL_BIT(h)) != 0);
+    }
+  }
+}
+
+/*
+ * The known maze as it will be if every outcome from the first level
+ * down to this node comes true. Index -1 is the maze before any of them.
+ */
+static void outcomeMaze(const specTree_t *tree, int index, maze_t *maze) {
+  *maze = tree->maze;
+  while (index >= 0) {
+    applyOutcome(maze, &tree->nodes[index]);
+    index = tree->nodes[index].parent;
+  }
+}
+
+static int keepRoute(specTree_t *tree, specNode_t *node, const char *route, const COMMAND *list) {
+  char *copy = arenaAlloc(&tree->arena, strlen(route) + 1);
+  if (copy == NULL) {
+    return -1;
+  }
+  strcpy(copy, route);
+  node->route = copy;
+  if (list != NULL) {
+    return arenaStorePath(&tree->arena, list, &node->path);
+  }
+  arenaBeginPath(&tree->arena);
+  makeDiagonalPath(route);
+  return arenaEndPath(&tree->arena, &node->path);
+}
+
+/*
+ * Plan one outcome: apply it to the maze its parent leads to, flood,
+ * and keep the route and the command list generated from it.
+ */
+static int planNode(specTree_t *tree, int parent, int depth, int cell, int heading, int sensed, int walls,
+                    const maze_t *before) {
+  maze_t maze;
+  uint16_t dist[MAZE_CELLS];
+  char route[MAX_ROUTE];
+  specNode_t *node;
+  int next = heading;
+  if (tree->count >= tree->capacity) {
+    return -1;
+  }
+  node = &tree->nodes[tree->count];
+  memset(node, 0, sizeof (*node));
+  node->cell = cell;
+  node->heading = heading;
+  node->sensed = sensed;
+  node->walls = walls;
+  node->depth = depth;
+  node->parent = parent;
+  node->firstChild = -1;
+  maze = *before;
+  applyOutcome(&maze, node);
+  floodMaze(&maze, dist);
+  if (makeRoute(&maze, dist, cell, heading, route, &next) < 0) {
+    node->status = SPEC_NO_ROUTE;
+  } else if (keepRoute(tree, node, route, NULL) != 0) {
+    return -1;
+  }
+  node->nextHeading = next;
+  tree->origin[tree->count++] = -1;
+  return 0;
+}
+
+/*
+ * Add a node for every combination of the walls that will be read in
+ * the cell the node's route enters next. Index -1 expands the cell the
+ * mouse is entering. Nothing is read in the goal.
+ */
+static int expandNode(specTree_t *tree, int index) {
+  maze_t maze;
+  specNode_t *node = index >= 0 ? &tree->nodes[index] : NULL;
+  int cell = tree->cell;
+  int heading = tree->heading;
+  int depth = 1;
+  int first = tree->count;
+  int sensed = 0;
+  int walls;
+  int i;
+  if (node != NULL) {
+    heading = node->nextHeading;
+    cell = mazeNeighbour(node->cell, heading);
+    depth = node->depth + 1;
+  }
+  if (!mazeIsGoal(cell)) {
+    outcomeMaze(tree, index, &maze);
+    for (i = 0; i < 4; i++) {
+      int h = (heading + i) & 3;
+      if (i != 2 && !mazeIsKnown(&maze, cell, h)) {
+        sensed |= WALL_BIT(h);
+      }
+    }
+    for (walls = 0; walls < 16; walls++) {
+      if ((walls & ~sensed) == 0 && planNode(tree, index, depth, cell, heading, sensed, walls, &maze) != 0) {
+        return -1;
+      }
+    }
+  }
+  if (node != NULL) {
+    node->firstChild = first;
+    node->childCount = tree->count - first;
+  }
+  return 0;
+}
+
+static int copyNode(specTree_t *tree, const specTree_t *old, int from, int parent, int depth) {
+  const specNode_t *source = &old->nodes[from];
+  specNode_t *node;
+  if (tree->count >= tree->capacity) {
+    return -1;
+  }
+  node = &tree->nodes[tree->count];
+  *node = *source;
+  node->parent = parent;
+  node->depth = depth;
+  node->firstChild = -1;
+  node->childCount = 0;
+  if (source->status == SPEC_ROUTE && keepRoute(tree, node, source->route, source->path.commands) != 0) {
+    return -1;
+  }
+  tree->origin[tree->count++] = from;
+  return 0;
+}
+
+/*
+ * The children of the node that was hit are the first level of the new
+ * tree, so copy the subtree under it breadth first rather than plan it
+ * again. Returns -1 if not even the first level could be copied.
+ */
+static int copySubtree(const speculator_t *spec, specTree_t *tree, const specTree_t *old, int hint) {
+  const specNode_t *top = &old->nodes[hint];
+  int i;
+  int c;
+  if (top->status != SPEC_ROUTE || top->firstChild < 0 || top->nextHeading != tree->heading ||
+      mazeNeighbour(top->cell, top->nextHeading) != tree->cell) {
+    return -1;
+  }
+  for (c = 0; c < top->childCount; c++) {
+    if (copyNode(tree, old, top->firstChild + c, -1, 1) != 0) {
+      return -1;
+    }
+  }
+  tree->firstCount = tree->count;
+  for (i = 0; i < tree->count; i++) {
+    const specNode_t *source = &old->nodes[tree->origin[i]];
+    int first = tree->count;
+    if (tree->nodes[i].depth >= spec->depth || source->firstChild < 0) {
+      continue;
+    }
+    for (c = 0; c < source->childCount; c++) {
+      if (copyNode(tree, old, source->firstChild + c, i, tree->nodes[i].depth + 1) != 0) {
+        return 0;
+      }
+    }
+    tree->nodes[i].firstChild = first;
+    tree->nodes[i].childCount = source->childCount;
+  }
+  return 0;
+}
+
+static int jobChanged(speculator_t *spec, unsigned job) {
+  int changed;
+  pthread_mutex_lock(&spec->lock);
+  changed = spec->stop || spec->job != job;
+  pthread_mutex_unlock(&spec->lock);
+  return changed;
+}
+
+/*
+ * Build the tree for one job. The first level is published as soon as it
+ * is complete so that a lookup never waits for the deeper levels, which
+ * are abandoned as soon as a newer job is started.
+ */
+static void build(speculator_t *spec, unsigned job, int hint) {
+  specTree_t *tree = &spec->trees[job & 1];
+  int i;
+  tree->count = 0;
+  tree->firstCount = 0;
+  arenaReset(&tree->arena);
+  if (hint >= 0 && copySubtree(spec, tree, &spec->trees[(job - 1) & 1], hint) == 0) {
+    spec->reused += tree->count;
+  } else {
+    tree->count = 0;
+    arenaReset(&tree->arena);
+    expandNode(tree, -1);
+    tree->firstCount = tree->count;
+    spec->built += tree->count;
+  }
+  pthread_mutex_lock(&spec->lock);
+  spec->firstDone = job;
+  pthread_cond_broadcast(&spec->ready);
+  pthread_mutex_unlock(&spec->lock);
+  for (i = 0; i < tree->count; i++) {
+    const specNode_t *node = &tree->nodes[i];
+    int count = tree->count;
+    if (node->depth >= spec->depth || node->firstChild >= 0 || node->status != SPEC_ROUTE) {
+      continue;
+    }
+    if (jobChanged(spec, job) || expandNode(tree, i) != 0) {
+      return;
+    }
+    spec->built += tree->count - count;
+  }
+}
+
+static void *specThread(void *arg) {
+  speculator_t *spec = arg;
+  pthread_mutex_lock(&spec->lock);
+  while (!spec->stop) {
+    unsigned job = spec->job;
+    int hint = spec->hint;
+    if (spec->taken == job) {
+      pthread_cond_wait(&spec->wake, &spec->lock);
+      continue;
+    }
+    spec->taken = job;
+    spec->trees[job & 1].maze = spec->maze;
+    spec->trees[job & 1].cell = spec->cell;
+    spec->trees[job & 1].heading = spec->heading;
+    pthread_mutex_unlock(&spec->lock);
+    build(spec, job, hint);
+    pthread_mutex_lock(&spec->lock);
+  }
+  pthread_mutex_unlock(&spec->lock);
+  return NULL;
+}
+
+/*
+ * The memory cap covers both trees. Each tree gets half, shared between
+ * the node array and an arena for the routes and command lists. All of
+ * it is allocated here, none while speculating.
+ */
+int specInit(speculator_t *spec, int depth, size_t memory) {
+  size_t half = memory / 2;
+  int capacity = (int) (half / (sizeof (specNode_t) + sizeof (int) + SPEC_NODE_ROOM));
+  int t;
+  memset(spec, 0, sizeof (*spec));
+  spec->depth = depth < 1 ? 1 : depth;
+  spec->hint = -1;
+  if (capacity < 1 || (spec->memory = malloc(2 * half)) == NULL) {
+    return -1;
+  }
+  for (t = 0; t < 2; t++) {
+    specTree_t *tree = &spec->trees[t];
+    uint8_t *block = (uint8_t *) spec->memory + t * half;
+    size_t used = capacity * (sizeof (specNode_t) + sizeof (int));
+    tree->capacity = capacity;
+    tree->nodes = (specNode_t *) block;
+    tree->origin = (int *) (block + capacity * sizeof (specNode_t));
+    arenaInit(&tree->arena, block + used, half - used);
+  }
+  pthread_mutex_init(&spec->lock, NULL);
+  pthread_cond_init(&spec->wake, NULL);
+  pthread_cond_init(&spec->ready, NULL);
+  if (pthread_create(&spec->thread, NULL, specThread, spec) != 0) {
+    pthread_mutex_destroy(&spec->lock);
+    pthread_cond_destroy(&spec->wake);
+    pthread_cond_destroy(&spec->ready);
+    free(spec->memory);
+    spec->memory = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void specFree(speculator_t *spec) {
+  if (spec->memory == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&spec->lock);
+  spec->stop = 1;
+  pthread_cond_broadcast(&spec->wake);
+  pthread_mutex_unlock(&spec->lock);
+  pthread_join(spec->thread, NULL);
+  pthread_mutex_destroy(&spec->lock);
+  pthread_cond_destroy(&spec->wake);
+  pthread_cond_destroy(&spec->ready);
+  free(spec->memory);
+  spec->memory = NULL;
+}
+
+/*
+ * Start speculating about the cell the mouse is about to enter, given
+ * what is known now. If the mouse got here through a lookup, pass the
+ * node that was hit so that its subtree is reused; the node is only
+ * valid until the next call.
+ */
+void specStart(speculator_t *spec, const maze_t *known, int cell, int heading, const specNode_t *hint) {
+  const specTree_t *tree = &spec->trees[spec->job & 1];
+  pthread_mutex_lock(&spec->lock);
+  spec->hint = -1;
+  if (hint != NULL && spec->job != 0 && hint >= tree->nodes && hint < tree->nodes + tree->capacity) {
+    spec->hint = (int) (hint - tree->nodes);
+  }
+  spec->maze = *known;
+  spec->cell = cell;
+  spec->heading = heading;
+  spec->job++;
+  pthread_cond_signal(&spec->wake);
+  pthread_mutex_unlock(&spec->lock);
+}
+
+/*
+ * Wait up to timeoutNs for the first level of the latest speculation. On
+ * a mouse this is the time spent driving into the cell, after which the
+ * walls are read and the decision cannot wait any longer.
+ * Returns 0 if the first level is ready, or nothing has been started,
+ * or -1 if it came too late, in
+ * which case the caller should plan for itself even if the result turns
+ * up a moment later.
+ */
+int specWait(speculator_t *spec, uint64_t timeoutNs) {
+  struct timespec deadline;
+  int ready;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += (time_t) (timeoutNs / 1000000000u);
+  deadline.tv_nsec += (long) (timeoutNs % 1000000000u);
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  pthread_mutex_lock(&spec->lock);
+  while (spec->job != 0 && spec->firstDone != spec->job) {
+    if (pthread_cond_timedwait(&spec->ready, &spec->lock, &deadline) != 0) {
+      break;
+    }
+  }
+  ready = spec->job == 0 || spec->firstDone == spec->job;
+  pthread_mutex_unlock(&spec->lock);
+  return ready ? 0 : -1;
+}
+
+/*
+ * Find the outcome that matches the walls now known around the cell.
+ * Never blocks: returns NULL if the first level is not ready yet, if the
+ * memory ran out before the outcome was planned or if it has no route.
+ */
+const specNode_t *specLookup(speculator_t *spec, const maze_t *known, int cell, int heading) {
+  const specTree_t *tree;
+  unsigned job;
+  int ready;
+  int i;
+  int h;
+  pthread_mutex_lock(&spec->lock);
+  job = spec->job;
+  ready = job != 0 && spec->firstDone == job;
+  pthread_mutex_unlock(&spec->lock);
+  if (!ready) {
+    return NULL;
+  }
+  tree = &spec->trees[job & 1];
+  for (i = 0; i < tree->firstCount; i++) {
+    const specNode_t *node = &tree->nodes[i];
+    int match = node->cell == cell && node->heading == heading;
+    for (h = 0; h < 4 && match; h++) {
+      if (node->sensed & WALL_BIT(h)) {
+        match = mazeIsKnown(known, cell, h) && mazeHasWall(known, cell, h) == ((node->walls & WALL_BIT(h)) != 0);
+      }
+    }
+    if (match) {
+      return node->status == SPEC_ROUTE ? node : NULL;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,120 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef SPECULATE_H
+#define	SPECULATE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "maze.h"
+#include "arena.h"
+
+  /*
+   * Speculative planning. While the mouse drives into the next cell the
+   * processor has nothing to do until the walls of that cell are read.
+   * A background thread uses that time to plan the route and generate
+   * the path for every way the unknown walls might turn out, and then
+   * for every way the walls of the cell after that might turn out, down
+   * to the speculation depth. When the reading arrives the decision is a
+   * table lookup.
+   *
+   * The outcomes form a tree built breadth first. The first level holds
+   * one node per combination of unknown left, front and right walls in
+   * the cell being entered; the children of a node are the outcomes in
+   * the cell its route enters next. Routes and command lists are kept in
+   * an arena so the memory cap holds however the tree grows; once it is
+   * full the tree is cut short and later lookups just miss. There are two
+   * trees: when a lookup hits, the next speculation starts by copying the
+   * subtree under the hit so that deeper levels are not planned twice.
+   *
+   * Each speculation plans with floodMaze() so the result is the same as
+   * planning with the full flood after the walls have been read.
+   */
+
+#define SPEC_ROUTE     (0)
+#define SPEC_NO_ROUTE  (1)
+
+  typedef struct {
+    uint8_t cell;         // the cell whose walls are read
+    uint8_t heading;      // heading on entering the cell
+    uint8_t sensed;       // WALL_BIT()s of the walls that were unknown
+    uint8_t walls;        // WALL_BIT()s of those present in this outcome
+    uint8_t nextHeading;  // heading of the first move of the route
+    uint8_t status;
+    uint8_t depth;        // 1 for the cell being entered
+    uint8_t childCount;
+    int parent;           // -1 on the first level
+    int firstChild;       // -1 until the node is expanded
+    const char *route;
+    pathResult_t path;
+  } specNode_t;
+
+  typedef struct {
+    maze_t maze;          // the known maze when the speculation started
+    arena_t arena;
+    specNode_t *nodes;
+    int *origin;          // node each one was copied from, or -1
+    int capacity;
+    int count;
+    int firstCount;       // nodes on the first level
+    int cell;
+    int heading;
+  } specTree_t;
+
+  typedef struct {
+    int depth;
+    specTree_t trees[2];  // job n is built in trees[n & 1]
+    maze_t maze;          // the latest job, until the thread takes it
+    int cell;
+    int heading;
+    int hint;             // node in the other tree, or -1
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t ready;
+    unsigned job;         // latest job started
+    unsigned taken;       // latest job the thread has picked up
+    unsigned firstDone;   // latest job with a complete first level
+    int stop;
+    long built;           // nodes planned
+    long reused;          // nodes copied from the previous tree
+    void *memory;
+  } speculator_t;
+
+  int specInit(speculator_t *spec, int depth, size_t memory);
+  void specFree(speculator_t *spec);
+  void specStart(speculator_t *spec, const maze_t *known, int cell, int heading, const specNode_t *hint);
+  int specWait(speculator_t *spec, uint64_t timeoutNs);
+  const specNode_t *specLookup(speculator_t *spec, const maze_t *known, int cell, int heading);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SPECULATE_H */
+
@@ -0,0 +1,150 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <math.h>
+#include "speedplan.h"
+
+/*
+ * The same mouse as defaultTimeModel.
+ */
+const speedProfile_t defaultSpeedProfile = {
+  180.0f, 3000.0f, 8000.0f, 8000.0f,
+  {
+    0.0f, 0.0f, // IP45
+    0.0f, 0.0f, // IP90
+    0.0f, 0.0f, // IP135
+    0.0f, 0.0f, // IP180
+    700.0f, 700.0f, // SS90S
+    1000.0f, 1000.0f, // SS90F
+    700.0f, 700.0f, // SS180
+    1000.0f, 1000.0f, // SD45
+    700.0f, 700.0f, // SD135
+    1000.0f, 1000.0f, // DS45
+    700.0f, 700.0f, // DS135
+    800.0f, 800.0f, // DD90
+    700.0f, 700.0f, // SS90E
+  }
+};
+
+/*
+ * The distance covered by a straight. Turns are driven at constant speed
+ * so their length does not matter here and is given as zero.
+ */
+float commandLength(const speedProfile_t *profile, COMMAND cmd) {
+  if (cmd <= CMD_SQUARES) {
+    return profile->cellLength * (cmd - FWD0);
+  }
+  if (cmd < CMD_TURN) {
+    return profile->cellLength * 0.70710678f * (cmd - DIA0);
+  }
+  return 0.0f;
+}
+
+static int isStraight(COMMAND cmd) {
+  return cmd < CMD_TURN;
+}
+
+static float turnSpeed(const speedProfile_t *profile, COMMAND cmd) {
+  COMMAND parts[INTEGRATED_PARTS];
+  if (cmd >= IP45R && cmd <= SS90EL) {
+    return profile->turnSpeed[cmd - IP45R];
+  }
+  if (integratedParts(cmd, parts) != 0) {
+    float entry = profile->turnSpeed[parts[0] - IP45R];
+    float exit = profile->turnSpeed[parts[2] - IP45R];
+    return entry < exit ? entry : exit;
+  }
+  return 0.0f; // errors and anything unknown stop the mouse
+}
+
+/*
+ * Work out the speed at the start and end of every command in a CMD_STOP
+ * terminated list and where each straight must start to brake.
+ *
+ * The mouse starts and finishes at rest. The first pass runs backwards
+ * from the end of the list. Every turn limits the speed at which it can
+ * be entered and every straight limits its entry speed to what can be
+ * braked away over its length. The second pass runs forwards and limits
+ * every exit speed to what can be reached by accelerating from the entry
+ * speed. Both passes are linear in the length of the list.
+ *
+ * info must have room for one entry per command.
+ * Returns the number of commands annotated.
+ */
+int annotateSpeeds(const COMMAND *list, speedInfo_t *info, const speedProfile_t *profile) {
+  float limit = 0.0f;
+  float speed = 0.0f;
+  int n = 0;
+  int i;
+  while (n < COMMAND_LIST_SIZE && list[n] != CMD_STOP) {
+    n++;
+  }
+  for (i = n - 1; i >= 0; i--) {
+    info[i].exitSpeed = (uint16_t) limit;
+    if (isStraight(list[i])) {
+      float v2 = limit * limit + 2.0f * profile->deceleration * commandLength(profile, list[i]);
+      limit = sqrtf(v2);
+      if (limit > profile->maxSpeed) {
+        limit = profile->maxSpeed;
+      }
+    } else {
+      float v = turnSpeed(profile, list[i]);
+      if (v < limit) {
+        limit = v;
+      }
+      info[i].exitSpeed = (uint16_t) limit;
+    }
+    info[i].entrySpeed = (uint16_t) limit;
+  }
+  for (i = 0; i < n; i++) {
+    float length = commandLength(profile, list[i]);
+    if (info[i].entrySpeed > speed) {
+      info[i].entrySpeed = (uint16_t) speed;
+    }
+    speed = info[i].entrySpeed;
+    if (isStraight(list[i])) {
+      float a = profile->acceleration;
+      float d = profile->deceleration;
+      float entry = speed;
+      float exit = sqrtf(entry * entry + 2.0f * a * length);
+      float peak;
+      if (exit > info[i].exitSpeed) {
+        exit = info[i].exitSpeed;
+      }
+      peak = sqrtf((length + entry * entry / (2.0f * a) + exit * exit / (2.0f * d)) / (1.0f / (2.0f * a) + 1.0f / (2.0f * d)));
+      if (peak > profile->maxSpeed) {
+        peak = profile->maxSpeed;
+      }
+      if (peak < exit) {
+        peak = exit;
+      }
+      info[i].exitSpeed = (uint16_t) exit;
+      info[i].brakePoint = (uint16_t) (length - (peak * peak - exit * exit) / (2.0f * d) + 0.5f);
+      speed = info[i].exitSpeed;
+    } else {
+      info[i].exitSpeed = info[i].entrySpeed;
+      info[i].brakePoint = 0;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,69 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef SPEEDPLAN_H
+#define	SPEEDPLAN_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+
+  /*
+   * Speed limits for one mouse. Speeds are in mm/s and lengths in mm.
+   * A turn speed of zero means the turn is done from a standstill, which
+   * is the case for the in-place turns.
+   */
+  typedef struct {
+    float cellLength;
+    float maxSpeed;
+    float acceleration;
+    float deceleration;
+    float turnSpeed[TURN_COUNT];
+  } speedProfile_t;
+
+  /*
+   * One entry for each command in the list, at the same index, so the
+   * controller needs no lookahead of its own. brakePoint is the distance
+   * from the start of a straight at which braking for the exit speed must
+   * begin. It is zero for turns, which are driven at a constant speed.
+   */
+  typedef struct {
+    uint16_t entrySpeed;
+    uint16_t exitSpeed;
+    uint16_t brakePoint;
+  } speedInfo_t;
+
+  extern const speedProfile_t defaultSpeedProfile;
+
+  float commandLength(const speedProfile_t *profile, COMMAND cmd);
+  int annotateSpeeds(const COMMAND *list, speedInfo_t *info, const speedProfile_t *profile);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SPEEDPLAN_H */
+
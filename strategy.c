@@ -0,0 +1,166 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include "makepath.h"
+#include "strategy.h"
+
+const char *strategyNames[STRATEGY_COUNT] = {"in-place", "smooth", "diagonal"};
+
+unsigned strategyCapabilities(strategy_t strategy) {
+  switch (strategy) {
+    case STRATEGY_IN_PLACE: return CAP_IN_PLACE;
+    case STRATEGY_SMOOTH: return CAP_SMOOTH_90 | CAP_SMOOTH_180;
+    case STRATEGY_DIAGONAL: return CAP_SMOOTH_90 | CAP_SMOOTH_180 | CAP_DIAGONAL;
+    default: return CAP_ALL + 1;
+  }
+}
+
+static void emitStraight(int cells) {
+  while (cells > CMD_SQUARES) {
+    emitCommand(FWD0 + CMD_SQUARES);
+    cells -= CMD_SQUARES;
+  }
+  if (cells > 0) {
+    emitCommand(FWD0 + cells);
+  }
+}
+
+/*
+ * Orthogonal paths. Turns are made at cell centres so the straights are
+ * whole cells. In smooth mode a turn is held back for one character to
+ * see whether it is the first half of a U turn, which is driven as a
+ * single SS180.
+ */
+void makeOrthogonalPath(const char *route, int smooth) {
+  int cells = 0;
+  char pending = 0;
+  clearCommands();
+  for (;; route++) {
+    char c = *route;
+    if (c == 'F') {
+      if (pending) {
+        emitCommand(pending == 'R' ? SS90SR : SS90SL);
+        pending = 0;
+      }
+      cells++;
+    } else if (c == 'R' || c == 'L') {
+      if (pending == c) {
+        emitCommand(c == 'R' ? SS180R : SS180L);
+        pending = 0;
+        cells = 1;
+        continue;
+      }
+      if (pending) {
+        emitCommand(pending == 'R' ? SS90SR : SS90SL);
+        pending = 0;
+      }
+      emitStraight(cells);
+      cells = 1;
+      if (smooth) {
+        pending = c;
+      } else {
+        emitCommand(c == 'R' ? IP90R : IP90L);
+      }
+    } else {
+      if (pending) {
+        emitCommand(pending == 'R' ? SS90SR : SS90SL);
+      }
+      emitStraight(cells);
+      if (c != 'S') {
+        emitCommand(CMD_ERROR_00);
+      }
+      emitCommand(CMD_STOP);
+      return;
+    }
+  }
+}
+
+void makeStrategyPath(const char *route, strategy_t strategy) {
+  if (strategy == STRATEGY_DIAGONAL) {
+    makeDiagonalPath(route);
+  } else {
+    makeOrthogonalPath(route, strategy == STRATEGY_SMOOTH);
+  }
+}
+
+/*
+ * Generate the route in every strategy the capabilities allow, each into
+ * its own buffer, and emit the fastest as if it had been generated
+ * directly, so it reaches the caller's command buffer or command sink.
+ * Lists with errors, or too long for the command list, are only chosen
+ * when nothing else is allowed, as the first allowed strategy. Returns
+ * the strategy used and its time through time, or -1 if no strategy is
+ * allowed.
+ */
+int makeBestPath(const char *route, unsigned capabilities, commandCostFn cost, const void *context, float *time) {
+  COMMAND lists[STRATEGY_COUNT][COMMAND_LIST_SIZE];
+  float times[STRATEGY_COUNT];
+  int counts[STRATEGY_COUNT];
+  commandSinkFn sink;
+  void *sinkContext;
+  COMMAND *buffer;
+  int size;
+  int fallback = -1;
+  int best = -1;
+  int s;
+  int i;
+  getCommandSink(&sink, &sinkContext);
+  getCommandBuffer(&buffer, &size);
+  setCommandSink(NULL, NULL);
+  for (s = 0; s < STRATEGY_COUNT; s++) {
+    int valid;
+    if ((strategyCapabilities(s) & ~capabilities) != 0) {
+      continue;
+    }
+    setCommandBuffer(lists[s], COMMAND_LIST_SIZE);
+    makeStrategyPath(route, s);
+    counts[s] = commandCount();
+    times[s] = listCost(cost, context, lists[s], counts[s]);
+    valid = lists[s][counts[s] - 1] == CMD_STOP;
+    for (i = 0; i < counts[s]; i++) {
+      valid &= lists[s][i] < CMD_ERROR_00;
+    }
+    if (fallback < 0) {
+      fallback = s;
+    }
+    if (valid && (best < 0 || times[s] < times[best])) {
+      best = s;
+    }
+  }
+  setCommandBuffer(buffer, size);
+  setCommandSink(sink, sinkContext);
+  if (best < 0) {
+    best = fallback;
+  }
+  if (best < 0) {
+    return -1;
+  }
+  for (i = 0; i < counts[best]; i++) {
+    emitCommand(lists[best][i]);
+  }
+  if (time != NULL) {
+    *time = times[best];
+  }
+  return best;
+}
@@ -0,0 +1,70 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef STRATEGY_H
+#define	STRATEGY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "commands.h"
+#include "timemodel.h"
+
+  /*
+   * The same route can be driven in several styles. The diagonal
+   * generator in makepath.c is not always the fastest: a mouse that is
+   * slow on diagonals, or a route with few zigzags, can be quicker with
+   * orthogonal smooth turns. Each strategy turns a route into a command
+   * list in one style, and makeBestPath() generates every style the mouse
+   * can drive, times each with a cost function and keeps the fastest.
+   *
+   *   STRATEGY_IN_PLACE  straights and IP90 turns
+   *   STRATEGY_SMOOTH    straights, SS90S turns and SS180 for a U turn
+   *   STRATEGY_DIAGONAL  the full diagonal command set
+   *
+   * All of them end at the same pose, the centre of the last cell of the
+   * route, and invalid routes give an error command as the diagonal
+   * generator does.
+   */
+
+  typedef enum {
+    STRATEGY_IN_PLACE,
+    STRATEGY_SMOOTH,
+    STRATEGY_DIAGONAL,
+    STRATEGY_COUNT
+  } strategy_t;
+
+  extern const char *strategyNames[STRATEGY_COUNT];
+
+  unsigned strategyCapabilities(strategy_t strategy);
+  void makeOrthogonalPath(const char *route, int smooth);
+  void makeStrategyPath(const char *route, strategy_t strategy);
+  int makeBestPath(const char *route, unsigned capabilities, commandCostFn cost, const void *context, float *time);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* STRATEGY_H */
+
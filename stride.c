@@ -0,0 +1,224 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include "stride.h"
+
+#define CLASS_OTHER (4)
+#define CLASS_END   (5)
+
+static strideEntry_t strideTable[STRIDE_STATES * STRIDE_CODES];
+static uint8_t charClass[256];
+static int strideReady;
+
+static const char classChar[5] = {'F', 'L', 'R', 'S', '?'};
+
+/*
+ * Run the single step machine over one stride. Commands are returned as
+ * ints so that a counter added to them is never wrapped. Returns the
+ * number of commands or -1 if there are more than a table entry holds.
+ */
+static int runStride(int *state, const char *chars, int *x, int *out) {
+  COMMAND step[PATH_MAX_EMITS];
+  int n = 0;
+  int i;
+  int j;
+  for (i = 0; i < PATH_STRIDE && *state != PathExit; i++) {
+    int count = pathStep(state, chars[i], x, step);
+    if (n + count > STRIDE_MAX_EMITS) {
+      return -1;
+    }
+    for (j = 0; j < count; j++) {
+      out[n++] = step[j];
+    }
+  }
+  return n;
+}
+
+static void strideChars(int code, char *chars) {
+  int i;
+  for (i = PATH_STRIDE - 1; i >= 0; i--) {
+    chars[i] = classChar[code % 5];
+    code /= 5;
+  }
+}
+
+/*
+ * Work out one table entry by running the machine from two counter
+ * values. Anything that moves with the counter is relative to it and
+ * anything else is a constant. Returns 0 or -1 if the stride cannot be
+ * described that way.
+ */
+static int buildEntry(int state, int code, strideEntry_t *e) {
+  int outA[STRIDE_MAX_EMITS];
+  int outB[STRIDE_MAX_EMITS];
+  char chars[PATH_STRIDE];
+  int stateA = state;
+  int stateB = state;
+  int xA = 40;
+  int xB = 80;
+  int nA;
+  int nB;
+  int i;
+  strideChars(code, chars);
+  nA = runStride(&stateA, chars, &xA, outA);
+  nB = runStride(&stateB, chars, &xB, outB);
+  if (nA < 0 || nA != nB || stateA != stateB) {
+    return -1;
+  }
+  e->next = (uint8_t) stateA;
+  if (xA == xB) {
+    e->keepX = 0;
+    e->addX = (uint8_t) xA;
+  } else if (xB - xA == 40) {
+    e->keepX = 1;
+    e->addX = (uint8_t) (xA - 40);
+  } else {
+    return -1;
+  }
+  e->count = (uint8_t) nA;
+  e->relative = 0;
+  for (i = 0; i < nA; i++) {
+    if (outA[i] == outB[i]) {
+      e->emit[i] = (COMMAND) outA[i];
+    } else if (outB[i] - outA[i] == 40) {
+      e->emit[i] = (COMMAND) (outA[i] - 40);
+      e->relative |= 1 << i;
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Build the character classes and the stride table.
+ * Returns 0 or -1 if the machine has a step the table cannot describe.
+ */
+int strideInit(void) {
+  int state;
+  int code;
+  int i;
+  for (i = 0; i < 256; i++) {
+    charClass[i] = CLASS_OTHER;
+  }
+  charClass['F'] = 0;
+  charClass['L'] = 1;
+  charClass['R'] = 2;
+  charClass['S'] = 3;
+  charClass[0] = CLASS_END;
+  for (state = 0; state < STRIDE_STATES; state++) {
+    for (code = 0; code < STRIDE_CODES; code++) {
+      if (buildEntry(state, code, &strideTable[state * STRIDE_CODES + code]) != 0) {
+        return -1;
+      }
+    }
+  }
+  strideReady = 1;
+  return 0;
+}
+
+/*
+ * Check every table entry against the single step machine for every
+ * counter value a command can hold.
+ * Returns the number of entries that do not match.
+ */
+int strideVerify(void) {
+  int errors = 0;
+  int state;
+  int code;
+  if (!strideReady && strideInit() != 0) {
+    return -1;
+  }
+  for (state = 0; state < STRIDE_STATES; state++) {
+    for (code = 0; code < STRIDE_CODES; code++) {
+      const strideEntry_t *e = &strideTable[state * STRIDE_CODES + code];
+      char chars[PATH_STRIDE];
+      int x;
+      strideChars(code, chars);
+      for (x = 0; x <= CMD_SQUARES; x++) {
+        int out[STRIDE_MAX_EMITS];
+        int next = state;
+        int x1 = x;
+        int n = runStride(&next, chars, &x1, out);
+        int i;
+        int bad = n != e->count || next != e->next || x1 != (e->keepX ? x : 0) + e->addX;
+        for (i = 0; !bad && i < n; i++) {
+          bad = out[i] != e->emit[i] + (((e->relative >> i) & 1) ? x : 0);
+        }
+        if (bad) {
+          errors++;
+          break;
+        }
+      }
+    }
+  }
+  return errors;
+}
+
+int strideTableSize(void) {
+  return sizeof (strideTable);
+}
+
+/*
+ * The same output as makeDiagonalPath() from PATH_STRIDE characters per
+ * lookup. The classes for a stride are read one at a time so that the
+ * terminator is seen before anything past it is read, and from then on
+ * the machine takes single steps exactly as makeDiagonalPath() does.
+ */
+void makeDiagonalPathStride(const char *s) {
+  COMMAND out[PATH_MAX_EMITS];
+  int state = PathStart;
+  int x = 0;
+  int tail = 0;       // the terminator is within reach, take single steps
+  if (!strideReady) {
+    strideInit();
+  }
+  clearCommands();
+  while (state != PathExit) {
+    const strideEntry_t *e;
+    int code = 0;
+    int i;
+    for (i = 0; i < PATH_STRIDE && !tail; i++) {
+      int c = charClass[(uint8_t) s[i]];
+      if (c == CLASS_END) {
+        tail = 1;
+        break;
+      }
+      code = code * 5 + c;
+    }
+    if (tail) {
+      int n = pathStep(&state, *s++, &x, out);
+      for (i = 0; i < n; i++) {
+        emitCommand(out[i]);
+      }
+      continue;
+    }
+    e = &strideTable[state * STRIDE_CODES + code];
+    for (i = 0; i < e->count; i++) {
+      emitCommand(e->emit[i] + (((e->relative >> i) & 1) ? x : 0));
+    }
+    x = (e->keepX ? x : 0) + e->addX;
+    state = e->next;
+    s += PATH_STRIDE;
+  }
+}
@@ -0,0 +1,91 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef STRIDE_H
+#define	STRIDE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+#include "makepath.h"
+
+  /*
+   * A form of the path generator that reads PATH_STRIDE characters per
+   * table lookup instead of one.
+   *
+   * Each character is one of five classes, F, L, R, S or anything else,
+   * so a table entry is indexed by the state and PATH_STRIDE classes. It
+   * holds the state after those characters, what happens to the cell
+   * counter and the commands to emit. The counter is either kept and
+   * increased or reset, and an emitted command is either a constant or
+   * a constant plus the counter as it was at the start of the stride.
+   *
+   * The table is built by strideInit() from pathStep() by running every
+   * state and string of classes twice with two different counter values,
+   * which is enough to tell constant parts from counter parts. It is
+   * built on first use if strideInit() has not been called.
+   *
+   * Near the end of the string the generator falls back to single steps
+   * so it never reads past the terminator.
+   *
+   * PATH_STRIDE may be set to 2 or 4 at build time. With 4 the table is
+   * much larger, see strideTableSize().
+   */
+
+#ifndef PATH_STRIDE
+#define PATH_STRIDE        (2)
+#endif
+
+#if PATH_STRIDE == 2
+#define STRIDE_CODES       (25)
+#elif PATH_STRIDE == 4
+#define STRIDE_CODES       (625)
+#else
+#error "PATH_STRIDE must be 2 or 4"
+#endif
+
+#define STRIDE_STATES      (PathExit)
+#define STRIDE_MAX_EMITS   (3 * PATH_STRIDE)
+
+  typedef struct {
+    uint8_t next;       // state after the stride
+    uint8_t keepX;      // 1 if the counter carries on, 0 if it is reset
+    uint8_t addX;       // then added to the counter
+    uint8_t count;      // commands to emit
+    uint16_t relative;  // bit i set if the counter is added to emit[i]
+    COMMAND emit[STRIDE_MAX_EMITS];
+  } strideEntry_t;
+
+  int strideInit(void);
+  int strideVerify(void);
+  int strideTableSize(void);
+  void makeDiagonalPathStride(const char *s);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* STRIDE_H */
@@ -374,3 +374,31 @@ int testCountDiagonal(void){
   return  sizeof (testPairsDiagonal) / sizeof (testPair_t);
 }
 
+
+/*
+ * Property tests need far more routes than can be written out by hand.
+ * This makes a random route that the path generator will accept: it
+ * starts with F, ends with S and never has three turns the same way in
+ * a row. The same seed always gives the same sequence of routes.
+ * Returns the length of the route including the S.
+ */
+int makeRandomRoute(char *route, int maxLength, uint32_t *seed) {
+  static const char moves[4] = {'F', 'F', 'L', 'R'};
+  int length;
+  int i;
+  *seed = *seed * 1664525u + 1013904223u;
+  length = 2 + (*seed >> 8) % (maxLength - 2);
+  route[0] = 'F';
+  for (i = 1; i < length - 1; i++) {
+    char c;
+    *seed = *seed * 1664525u + 1013904223u;
+    c = moves[(*seed >> 16) & 3];
+    if (i >= 2 && c != 'F' && route[i - 1] == c && route[i - 2] == c) {
+      c = 'F';
+    }
+    route[i] = c;
+  }
+  route[length - 1] = 'S';
+  route[length] = 0;
+  return length;
+}
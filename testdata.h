@@ -28,6 +28,8 @@ THE SOFTWARE.
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #define MAX_CMD_COUNT 256
 
   typedef struct {
@@ -39,6 +41,7 @@ extern "C" {
 
 
   int testCountDiagonal();
+  int makeRandomRoute(char *route, int maxLength, uint32_t *seed);
 
 
 #ifdef	__cplusplus
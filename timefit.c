@@ -0,0 +1,334 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timefit.h"
+
+static const char *shapeNames[6] = {
+  "straightBase", "straightPerCell", "straightPerRootCell",
+  "diagonalBase", "diagonalPerCell", "diagonalPerRootCell"
+};
+
+/*
+ * Parameters are numbered in the order they appear in timeModel_t.
+ */
+float *timeModelParam(timeModel_t *model, int index) {
+  float *shape[6] = {
+    &model->straightBase, &model->straightPerCell, &model->straightPerRootCell,
+    &model->diagonalBase, &model->diagonalPerCell, &model->diagonalPerRootCell
+  };
+  if (index < 6) {
+    return shape[index];
+  }
+  if (index < 6 + TURN_COUNT) {
+    return &model->turn[index - 6];
+  }
+  return &model->integrated[index - 6 - TURN_COUNT];
+}
+
+const char *timeModelParamName(int index, char *text, int size) {
+  if (index < 6) {
+    snprintf(text, size, "%s", shapeNames[index]);
+  } else if (index < 6 + TURN_COUNT) {
+    formatCommand(IP45R + index - 6, text, size);
+  } else {
+    formatCommand(CMD_INTEGRATED + index - 6 - TURN_COUNT, text, size);
+  }
+  return text;
+}
+
+/*
+ * The terms one command adds to the predicted time, as parameter numbers
+ * and the values they are multiplied by. Mirrors commandTime().
+ */
+static int commandTerms(COMMAND cmd, int *index, double *value) {
+  int base;
+  int n;
+  if (cmd >= CMD_INTEGRATED && cmd < CMD_INTEGRATED + INTEGRATED_COUNT) {
+    index[0] = 6 + TURN_COUNT + cmd - CMD_INTEGRATED;
+    value[0] = 1.0;
+    return 1;
+  }
+  if (cmd == CMD_STOP || cmd > SS90EL) {
+    return 0;
+  }
+  if (cmd >= CMD_TURN) {
+    index[0] = 6 + cmd - IP45R;
+    value[0] = 1.0;
+    return 1;
+  }
+  base = cmd < CMD_DIAGONAL ? 0 : 3;
+  n = cmd & CMD_SQUARES;
+  if (n == 0) {
+    return 0;
+  }
+  index[0] = base;
+  index[1] = base + 1;
+  index[2] = base + 2;
+  value[0] = 1.0;
+  value[1] = n;
+  value[2] = sqrt((double) n);
+  return 3;
+}
+
+void fitClear(timeFit_t *fit) {
+  memset(fit, 0, sizeof (*fit));
+}
+
+/*
+ * Add one row to the normal equations. The row is sparse, a segment
+ * touches only a few of the parameters, so only those products are
+ * accumulated.
+ */
+void fitAddSegment(timeFit_t *fit, const COMMAND *commands, int n, double seconds) {
+  double row[FIT_PARAMS];
+  int used[FIT_PARAMS];
+  int count = 0;
+  int i;
+  int j;
+  memset(row, 0, sizeof (row));
+  for (i = 0; i < n; i++) {
+    int index[3];
+    double value[3];
+    int k = commandTerms(commands[i], index, value);
+    for (j = 0; j < k; j++) {
+      if (row[index[j]] == 0.0) {
+        used[count++] = index[j];
+      }
+      row[index[j]] += value[j];
+    }
+  }
+  for (i = 0; i < count; i++) {
+    int a = used[i];
+    fit->xty[a] += row[a] * seconds;
+    fit->uses[a]++;
+    for (j = 0; j < count; j++) {
+      fit->xtx[a][used[j]] += row[a] * row[used[j]];
+    }
+  }
+  fit->yy += seconds * seconds;
+  fit->segments++;
+}
+
+/*
+ * Solve (XtX + wI) p = Xty + w prior by Cholesky factorisation. The
+ * weight w counts as that many segments agreeing exactly with the prior
+ * on each parameter. Returns 0, or -1 if there is nothing to fit or the
+ * system cannot be solved. The RMS residual over the segments is
+ * returned through rms if it is not NULL.
+ */
+int fitSolve(const timeFit_t *fit, const timeModel_t *prior, double weight, timeModel_t *model, double *rms) {
+  static const int n = FIT_PARAMS;
+  double a[FIT_PARAMS][FIT_PARAMS];
+  double b[FIT_PARAMS];
+  double p[FIT_PARAMS];
+  double sse;
+  timeModel_t start = *prior;
+  int i;
+  int j;
+  int k;
+  if (fit->segments == 0 || weight <= 0.0) {
+    return -1;
+  }
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++) {
+      a[i][j] = fit->xtx[i][j];
+    }
+    a[i][i] += weight;
+    b[i] = fit->xty[i] + weight * *timeModelParam(&start, i);
+  }
+  for (j = 0; j < n; j++) {
+    double d = a[j][j];
+    for (k = 0; k < j; k++) {
+      d -= a[j][k] * a[j][k];
+    }
+    if (d <= 0.0) {
+      return -1;
+    }
+    a[j][j] = sqrt(d);
+    for (i = j + 1; i < n; i++) {
+      double s = a[i][j];
+      for (k = 0; k < j; k++) {
+        s -= a[i][k] * a[j][k];
+      }
+      a[i][j] = s / a[j][j];
+    }
+  }
+  for (i = 0; i < n; i++) {
+    double s = b[i];
+    for (k = 0; k < i; k++) {
+      s -= a[i][k] * p[k];
+    }
+    p[i] = s / a[i][i];
+  }
+  for (i = n - 1; i >= 0; i--) {
+    double s = p[i];
+    for (k = i + 1; k < n; k++) {
+      s -= a[k][i] * p[k];
+    }
+    p[i] = s / a[i][i];
+  }
+  sse = fit->yy;
+  for (i = 0; i < n; i++) {
+    sse -= 2.0 * p[i] * fit->xty[i];
+    for (j = 0; j < n; j++) {
+      sse += p[i] * fit->xtx[i][j] * p[j];
+    }
+  }
+  if (rms != NULL) {
+    *rms = sqrt(sse > 0.0 ? sse / fit->segments : 0.0);
+  }
+  *model = start;
+  for (i = 0; i < n; i++) {
+    *timeModelParam(model, i) = (float) p[i];
+  }
+  return 0;
+}
+
+/*
+ * Returns the number of segments read.
+ */
+long fitReadCsv(timeFit_t *fit, FILE *in) {
+  char line[4096];
+  COMMAND commands[FIT_MAX_SEGMENT];
+  long count = 0;
+  while (fgets(line, sizeof (line), in) != NULL) {
+    char *end;
+    char *field;
+    double seconds;
+    int n = 0;
+    int bad = 0;
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == 0) {
+      continue;
+    }
+    seconds = strtod(line, &end);
+    if (end == line || *end != ',') {
+      fit->rejected++;
+      continue;
+    }
+    field = strtok(end + 1, ",\r\n");
+    while (field != NULL && !bad) {
+      if (n == FIT_MAX_SEGMENT || parseCommand(field, &commands[n++]) != 0) {
+        bad = 1;
+      }
+      field = strtok(NULL, ",\r\n");
+    }
+    if (bad || n == 0) {
+      fit->rejected++;
+      continue;
+    }
+    fitAddSegment(fit, commands, n, seconds);
+    count++;
+  }
+  return count;
+}
+
+/*
+ * Returns the number of segments read. A truncated record at the end of
+ * the file counts as rejected.
+ */
+long fitReadBinary(timeFit_t *fit, FILE *in) {
+  COMMAND commands[FIT_MAX_SEGMENT];
+  unsigned char t[4];
+  long count = 0;
+  int n;
+  while ((n = fgetc(in)) != EOF) {
+    if (n == 0 || fread(commands, 1, n, in) != (size_t) n || fread(t, 1, sizeof (t), in) != sizeof (t)) {
+      fit->rejected++;
+      break;
+    }
+    fitAddSegment(fit, commands, n, (t[0] | t[1] << 8 | t[2] << 16 | (uint32_t) t[3] << 24) * 1e-6);
+    count++;
+  }
+  return count;
+}
+
+/*
+ * Load "parameter value" lines over the model. Parameters that are not
+ * mentioned keep their values. Returns the number loaded, or -1 at the
+ * first line that cannot be read.
+ */
+int timeModelRead(timeModel_t *model, FILE *in) {
+  char line[128];
+  int count = 0;
+  while (fgets(line, sizeof (line), in) != NULL) {
+    char name[32];
+    char text[32];
+    float value;
+    int i;
+    if (line[0] == '#' || sscanf(line, "%31s", name) != 1) {
+      continue;
+    }
+    if (sscanf(line, "%31s %f", name, &value) != 2) {
+      return -1;
+    }
+    for (i = 0; i < FIT_PARAMS; i++) {
+      if (strcmp(name, timeModelParamName(i, text, sizeof (text))) == 0) {
+        break;
+      }
+    }
+    if (i == FIT_PARAMS) {
+      return -1;
+    }
+    *timeModelParam(model, i) = value;
+    count++;
+  }
+  return count;
+}
+
+/*
+ * Write the model as a C initialiser called name, laid out like
+ * defaultTimeModel, or as parameter lines if name is NULL.
+ */
+void timeModelWrite(const timeModel_t *model, FILE *out, const char *name) {
+  timeModel_t copy = *model;
+  char text[32];
+  int i;
+  if (name == NULL) {
+    for (i = 0; i < FIT_PARAMS; i++) {
+      fprintf(out, "%-20s %.6f\n", timeModelParamName(i, text, sizeof (text)), *timeModelParam(&copy, i));
+    }
+    return;
+  }
+  fprintf(out, "const timeModel_t %s = {\n", name);
+  fprintf(out, "  %.4ff, %.4ff, %.4ff,\n", copy.straightBase, copy.straightPerCell, copy.straightPerRootCell);
+  fprintf(out, "  %.4ff, %.4ff, %.4ff,\n", copy.diagonalBase, copy.diagonalPerCell, copy.diagonalPerRootCell);
+  fprintf(out, "  {\n");
+  for (i = 0; i < TURN_COUNT; i += 2) {
+    formatCommand(IP45R + i, text, sizeof (text));
+    text[strlen(text) - 1] = 0;
+    fprintf(out, "    %.4ff, %.4ff, // %s\n", copy.turn[i], copy.turn[i + 1], text);
+  }
+  fprintf(out, "  },\n  {\n");
+  for (i = 0; i < INTEGRATED_COUNT; i += 2) {
+    char *join;
+    formatCommand(CMD_INTEGRATED + i, text, sizeof (text));
+    text[strlen(text) - 1] = 0;
+    join = strchr(text, '_');
+    memmove(join - 1, join, strlen(join) + 1);
+    fprintf(out, "    %.4ff, %.4ff, // %s\n", copy.integrated[i], copy.integrated[i + 1], text);
+  }
+  fprintf(out, "  }\n};\n");
+}
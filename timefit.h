@@ -0,0 +1,91 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef TIMEFIT_H
+#define	TIMEFIT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include "commands.h"
+#include "timemodel.h"
+
+  /*
+   * Fit a timeModel_t to recorded runs by linear least squares. A log is
+   * a sequence of segments, each a few commands and the time measured
+   * for them. Every parameter of the model enters the predicted time
+   * linearly, including the per cell and root cell terms that carry the
+   * speed profile, so each segment adds one row to the normal equations
+   * and the log is read once, in constant memory, whatever its length.
+   *
+   * The fit is pulled gently towards a prior model, so that parameters
+   * the log never exercises keep their prior values and parameters it
+   * hardly separates, such as the base and root cell terms of a single
+   * straight length, stay sensible.
+   *
+   * CSV logs have one segment per line: the time in seconds then the
+   * command names, such as
+   *   0.4315,FWD3,SS90SR,FWD1
+   * Blank lines and lines starting with # are skipped.
+   *
+   * A fitted model is written either as a C initialiser to compile in or,
+   * with no name, as one "parameter value" line per parameter that
+   * timeModelRead() loads over a model at start up. Parameter names are
+   * straightBase, straightPerCell, straightPerRootCell, the same three for
+   * diagonal, and the turn and integrated turn names.
+   *
+   * Binary logs have one record per segment: a count byte (1..255), that
+   * many command bytes and the time in microseconds as a little endian
+   * 32 bit integer.
+   */
+
+#define FIT_PARAMS         (6 + TURN_COUNT + INTEGRATED_COUNT)
+#define FIT_MAX_SEGMENT    (255)
+
+  typedef struct {
+    double xtx[FIT_PARAMS][FIT_PARAMS];
+    double xty[FIT_PARAMS];
+    double yy;
+    long segments;
+    long uses[FIT_PARAMS];   // segments that exercise each parameter
+    long rejected;           // lines or records that could not be read
+  } timeFit_t;
+
+  void fitClear(timeFit_t *fit);
+  void fitAddSegment(timeFit_t *fit, const COMMAND *commands, int n, double seconds);
+  int fitSolve(const timeFit_t *fit, const timeModel_t *prior, double weight, timeModel_t *model, double *rms);
+  long fitReadCsv(timeFit_t *fit, FILE *in);
+  long fitReadBinary(timeFit_t *fit, FILE *in);
+  float *timeModelParam(timeModel_t *model, int index);
+  const char *timeModelParamName(int index, char *text, int size);
+  int timeModelRead(timeModel_t *model, FILE *in);
+  void timeModelWrite(const timeModel_t *model, FILE *out, const char *name);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TIMEFIT_H */
+
@@ -0,0 +1,107 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <math.h>
+#include "timemodel.h"
+
+/*
+ * Rough figures for a mouse on 180mm cells with a top speed near 3m/s
+ * and 0.7 to 1m/s through the smooth turns. The integrated turns are
+ * put at about 85% of their parts since the mouse does not have to settle
+ * on the short diagonal between them. Refit them for a real mouse.
+ */
+const timeModel_t defaultTimeModel = {
+  0.000f, 0.060f, 0.100f,
+  0.000f, 0.045f, 0.080f,
+  {
+    0.250f, 0.250f, // IP45
+    0.350f, 0.350f, // IP90
+    0.450f, 0.450f, // IP135
+    0.550f, 0.550f, // IP180
+    0.280f, 0.280f, // SS90S
+    0.200f, 0.200f, // SS90F
+    0.450f, 0.450f, // SS180
+    0.180f, 0.180f, // SD45
+    0.380f, 0.380f, // SD135
+    0.180f, 0.180f, // DS45
+    0.380f, 0.380f, // DS135
+    0.250f, 0.250f, // DD90
+    0.300f, 0.300f, // SS90E
+  },
+  {
+    0.480f, 0.480f, // SD45_DS45
+    0.650f, 0.650f, // SD45_DS135
+    0.540f, 0.540f, // SD45_DD90
+    0.650f, 0.650f, // SD135_DS45
+    0.820f, 0.820f, // SD135_DS135
+    0.710f, 0.710f, // SD135_DD90
+    0.540f, 0.540f, // DD90_DS45
+    0.710f, 0.710f, // DD90_DS135
+    0.600f, 0.600f, // DD90_DD90
+  }
+};
+
+/*
+ * The time for one command. CMD_STOP and anything that is not a movement
+ * command cost nothing.
+ */
+float commandTime(const timeModel_t *model, COMMAND cmd) {
+  int n;
+  if (cmd == CMD_STOP) {
+    return 0.0f;
+  }
+  if (cmd <= CMD_SQUARES) {
+    n = cmd - FWD0;
+    return model->straightBase + model->straightPerCell * n + model->straightPerRootCell * sqrtf((float) n);
+  }
+  if (cmd < CMD_TURN) {
+    n = cmd - DIA0;
+    if (n == 0) {
+      return 0.0f;
+    }
+    return model->diagonalBase + model->diagonalPerCell * n + model->diagonalPerRootCell * sqrtf((float) n);
+  }
+  if (cmd <= SS90EL) {
+    return model->turn[cmd - IP45R];
+  }
+  if (cmd >= CMD_INTEGRATED && cmd < CMD_INTEGRATED + INTEGRATED_COUNT) {
+    return model->integrated[cmd - CMD_INTEGRATED];
+  }
+  return 0.0f;
+}
+
+float timeModelCost(const void *model, COMMAND cmd) {
+  return commandTime((const timeModel_t *) model, cmd);
+}
+
+/*
+ * The total cost of at most n commands, stopping at CMD_STOP.
+ */
+float listCost(commandCostFn cost, const void *context, const COMMAND *list, int n) {
+  float total = 0.0f;
+  int i;
+  for (i = 0; i < n && list[i] != CMD_STOP; i++) {
+    total += cost(context, list[i]);
+  }
+  return total;
+}
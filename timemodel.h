@@ -0,0 +1,71 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef TIMEMODEL_H
+#define	TIMEMODEL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "commands.h"
+
+  /*
+   * An estimate of how long the mouse takes to execute each command, in
+   * seconds. Straights are modelled as a fixed cost plus terms in the
+   * number of cells and its square root. The square root term accounts
+   * for the time spent accelerating and braking, which makes a long
+   * straight cheaper per cell than a short one. Turns have a fixed cost
+   * each, and so do the integrated turns, which a mouse that knows them
+   * drives faster than their three parts.
+   *
+   * Anything that ranks paths by time takes a cost function and a
+   * context pointer so that a different model can be plugged in for a
+   * different mouse. timeModelCost() adapts a timeModel_t to that.
+   */
+
+  typedef struct {
+    float straightBase;
+    float straightPerCell;
+    float straightPerRootCell;
+    float diagonalBase;
+    float diagonalPerCell;
+    float diagonalPerRootCell;
+    float turn[TURN_COUNT];
+    float integrated[INTEGRATED_COUNT];
+  } timeModel_t;
+
+  typedef float (*commandCostFn)(const void *context, COMMAND cmd);
+
+  extern const timeModel_t defaultTimeModel;
+
+  float commandTime(const timeModel_t *model, COMMAND cmd);
+  float timeModelCost(const void *model, COMMAND cmd);
+  float listCost(commandCostFn cost, const void *context, const COMMAND *list, int n);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TIMEMODEL_H */
+
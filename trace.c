@@ -0,0 +1,123 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+/*
+ * The names of the generator states in makepath.c, in order.
+ */
+static const char *stateNames[16] = {
+  "Start", "Ortho_F", "Ortho_R", "Ortho_L", "Ortho_RR", "Ortho_LL", "Diag_RL", "Diag_LR",
+  "Diag_RR", "Diag_LL", "Stop", "Exit", "Error", "?13", "?14", "?15"
+};
+
+#ifdef PATH_TRACE
+
+CMD_THREAD_LOCAL traceRing_t traceRing;
+
+/*
+ * The calling thread's ring, so that another thread can read it.
+ */
+traceRing_t *traceCurrent(void) {
+  return &traceRing;
+}
+
+/*
+ * Only the thread that owns a ring may clear it.
+ */
+void traceClear(traceRing_t *ring) {
+  int i;
+  for (i = 0; i < TRACE_SIZE; i++) {
+    atomic_store_explicit(&ring->records[i], 0, memory_order_relaxed);
+  }
+  atomic_store_explicit(&ring->head, 0, memory_order_release);
+}
+
+/*
+ * Copy the records in a ring, oldest first. Returns the number copied,
+ * at most size and at most TRACE_SIZE. Records the owner overwrote while
+ * they were being copied are dropped from the front.
+ */
+int traceSnapshot(const traceRing_t *ring, uint32_t *records, int size) {
+  unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  unsigned count = head < TRACE_SIZE ? head : TRACE_SIZE;
+  unsigned first;
+  unsigned later;
+  unsigned lost;
+  unsigned i;
+  if (count > (unsigned) size) {
+    count = size;
+  }
+  first = head - count;
+  for (i = 0; i < count; i++) {
+    records[i] = atomic_load_explicit(&ring->records[(first + i) & (TRACE_SIZE - 1)], memory_order_relaxed);
+  }
+  atomic_thread_fence(memory_order_acquire);
+  later = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  lost = later - head > TRACE_SIZE - count ? later - head - (TRACE_SIZE - count) : 0;
+  if (lost >= count) {
+    return 0;
+  }
+  memmove(records, records + lost, (count - lost) * sizeof (*records));
+  return (int) (count - lost);
+}
+
+#endif
+
+/*
+ * One record as a line of text, without the newline.
+ */
+int traceFormat(uint32_t record, char *text, int size) {
+  char name[16] = "-";
+  char c = TRACE_CHAR(record);
+  if (record & TRACE_EMITTED) {
+    formatCommand(TRACE_COMMAND(record), name, sizeof (name));
+  }
+  return snprintf(text, size, "%4u %c%c%c %-8s -> %-8s %s", (unsigned) TRACE_POSITION(record),
+                  c ? '\'' : ' ', c ? c : '0', c ? '\'' : ' ', stateNames[TRACE_BEFORE(record)],
+                  stateNames[TRACE_AFTER(record)], name);
+}
+
+/*
+ * Read little endian records from a trace dump until the end of the file
+ * and write them out as text, with a heading at the start of each path.
+ * Returns the number of records decoded.
+ */
+int traceDecode(FILE *in, FILE *out) {
+  unsigned char bytes[4];
+  char text[64];
+  int paths = 0;
+  int count = 0;
+  while (fread(bytes, 1, sizeof (bytes), in) == sizeof (bytes)) {
+    uint32_t record = bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+    if (record & TRACE_FIRST) {
+      fprintf(out, "path %d\n", ++paths);
+    }
+    traceFormat(record, text, sizeof (text));
+    fprintf(out, "%s\n", text);
+    count++;
+  }
+  return count;
+}
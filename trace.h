@@ -0,0 +1,146 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef __cplusplus
+#include <stdatomic.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include "commands.h"
+
+  /*
+   * A flight recorder for the path generator. Build with -DPATH_TRACE
+   * and every step of the state machine is written to a ring buffer as
+   * one 32 bit record per command emitted, or a single record if the step
+   * emitted nothing. Without PATH_TRACE the TRACE_ macros expand to
+   * nothing, the generator is unchanged and there is no ring at all; only
+   * the record layout and the decoder are left for the host.
+   *
+   * With CMD_THREADS each thread records into its own ring. Recording
+   * is two plain stores and never waits. Any thread may read a ring
+   * while its owner is writing: traceSnapshot() checks the position
+   * again after copying and drops anything that was overwritten
+   * meanwhile. The ring keeps the latest TRACE_SIZE records and
+   * overwrites the oldest. The ring is built on C11 atomics, so from C++
+   * traceRing_t is an opaque type that can only be used through a
+   * pointer, and the recording side is C only.
+   *
+   * Records are sent or saved as they are, little endian, and the host
+   * turns them back into text with traceFormat() or diagonal-trace.
+   *
+   * B7:0   command emitted
+   * B11:8  state before the step
+   * B15:12 state after the step
+   * B23:16 position of the character in the route
+   * B26:24 character: 0 => NUL, 1 => F, 2 => L, 3 => R, 4 => S, 7 => other
+   * B27    a command was emitted
+   * B28    first step of a path
+   * B30:29 which of the step's commands this is
+   */
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE        (4096)   // records, a power of two
+#endif
+
+#define TRACE_EMITTED     (1u << 27)
+#define TRACE_FIRST       (1u << 28)
+
+#define TRACE_COMMAND(r)  ((COMMAND) ((r) & 0xFF))
+#define TRACE_BEFORE(r)   (((r) >> 8) & 0x0F)
+#define TRACE_AFTER(r)    (((r) >> 12) & 0x0F)
+#define TRACE_POSITION(r) (((r) >> 16) & 0xFF)
+#define TRACE_CHAR(r)     ("\0FLRS???"[((r) >> 24) & 0x07])
+#define TRACE_INDEX(r)    (((r) >> 29) & 0x03)
+
+#ifdef PATH_TRACE
+
+  typedef struct traceRing_s traceRing_t;
+
+#ifndef __cplusplus
+  struct traceRing_s {
+    atomic_uint head;                       // records ever written
+    atomic_uint records[TRACE_SIZE];
+  };
+
+  extern CMD_THREAD_LOCAL traceRing_t traceRing;
+
+  static inline uint32_t traceCharCode(char c) {
+    switch (c) {
+      case 0: return 0;
+      case 'F': return 1;
+      case 'L': return 2;
+      case 'R': return 3;
+      case 'S': return 4;
+      default: return 7;
+    }
+  }
+
+  static inline void traceRecord(uint32_t record) {
+    traceRing_t *ring = &traceRing;
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->records[head & (TRACE_SIZE - 1)], record, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  }
+
+  static inline void traceStep(int first, int position, char c, int before, int after, const COMMAND *out, int n) {
+    uint32_t record = ((uint32_t) (before & 0x0F) << 8) | ((uint32_t) (after & 0x0F) << 12) |
+            ((uint32_t) (position & 0xFF) << 16) | (traceCharCode(c) << 24) | (first ? TRACE_FIRST : 0);
+    int i;
+    if (n == 0) {
+      traceRecord(record);
+    }
+    for (i = 0; i < n; i++) {
+      traceRecord(record | TRACE_EMITTED | ((uint32_t) i << 29) | out[i]);
+    }
+  }
+
+#define TRACE_STEP(first, position, c, before, after, out, n) \
+  traceStep(first, position, c, before, after, out, n)
+#endif
+
+  traceRing_t *traceCurrent(void);
+  void traceClear(traceRing_t *ring);
+  int traceSnapshot(const traceRing_t *ring, uint32_t *records, int size);
+
+#else
+
+#define TRACE_STEP(first, position, c, before, after, out, n) ((void) (before))
+
+#endif
+
+  int traceFormat(uint32_t record, char *text, int size);
+  int traceDecode(FILE *in, FILE *out);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRACE_H */
+
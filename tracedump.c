@@ -0,0 +1,126 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "commands.h"
+#include "makepath.h"
+#include "trace.h"
+
+/*
+ * Turn generator traces back into text on the host.
+ *
+ *   diagonal-trace [dump files]
+ *   diagonal-trace -r [-o file] route...
+ *
+ * With no options each dump file, or stdin, is read as little endian
+ * trace records and decoded. With -r each route is put through the
+ * generator and the trace it leaves is decoded, or written as a binary
+ * dump to the -o file. The Makefile always builds this tool, and the
+ * generator it links, with -DPATH_TRACE.
+ */
+
+#ifndef PATH_TRACE
+#error "diagonal-trace runs the generator with its trace on and needs -DPATH_TRACE"
+#endif
+
+static int traceRoutes(int count, char **routes, const char *dumpName) {
+  static uint32_t records[TRACE_SIZE];
+  FILE *dump;
+  int n;
+  int i;
+  traceClear(traceCurrent());
+  for (i = 0; i < count; i++) {
+    makeDiagonalPath(routes[i]);
+  }
+  n = traceSnapshot(traceCurrent(), records, TRACE_SIZE);
+  if (dumpName == NULL) {
+    char text[64];
+    int path = count;
+    for (i = 0; i < n; i++) {
+      path -= (records[i] & TRACE_FIRST) != 0;
+    }
+    for (i = 0; i < n; i++) {
+      if (records[i] & TRACE_FIRST) {
+        printf("path %s\n", routes[path++]);
+      }
+      traceFormat(records[i], text, sizeof (text));
+      printf("%s\n", text);
+    }
+    return EXIT_SUCCESS;
+  }
+  dump = fopen(dumpName, "wb");
+  if (dump == NULL) {
+    fprintf(stderr, "could not write %s\n", dumpName);
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < n; i++) {
+    unsigned char bytes[4] = {records[i], records[i] >> 8, records[i] >> 16, records[i] >> 24};
+    fwrite(bytes, 1, sizeof (bytes), dump);
+  }
+  fclose(dump);
+  return EXIT_SUCCESS;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: diagonal-trace [dump files] | diagonal-trace -r [-o file] route...\n");
+}
+
+int main(int argc, char** argv) {
+  const char *dumpName = NULL;
+  int routes = 0;
+  int i;
+  for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i++) {
+    if (strcmp(argv[i], "-r") == 0) {
+      routes = 1;
+    } else if (i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+      dumpName = argv[++i];
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (routes) {
+    if (i == argc) {
+      usage();
+      return EXIT_FAILURE;
+    }
+    return traceRoutes(argc - i, argv + i, dumpName);
+  }
+  if (i == argc) {
+    traceDecode(stdin, stdout);
+  }
+  for (; i < argc; i++) {
+    FILE *in = fopen(argv[i], "rb");
+    if (in == NULL) {
+      fprintf(stderr, "could not read %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    traceDecode(in, stdout);
+    fclose(in);
+  }
+  return EXIT_SUCCESS;
+}
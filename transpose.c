@@ -0,0 +1,148 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "transpose.h"
+
+/*
+ * The splitmix64 finaliser. Consecutive inputs give unrelated outputs,
+ * which is all a Zobrist key needs.
+ */
+static uint64_t mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+/*
+ * The key for one wall in one state: 0 unknown, 1 open, 2 present. A
+ * wall seen from either side is named by the cell to its south or west
+ * so that both sides give the same key.
+ */
+uint64_t zobristWall(int cell, int heading, int state) {
+  int next = mazeNeighbour(cell, heading);
+  if (state == 0) {
+    return 0;
+  }
+  if ((heading == SOUTH || heading == WEST) && next >= 0) {
+    cell = next;
+    heading = (heading + 2) & 3;
+  }
+  return mix(((uint64_t) cell * 4 + heading) * 2 + state);
+}
+
+static int wallState(const maze_t *maze, int cell, int heading) {
+  if (!mazeIsKnown(maze, cell, heading)) {
+    return 0;
+  }
+  return mazeHasWall(maze, cell, heading) ? 2 : 1;
+}
+
+/*
+ * The hash of a whole maze from scratch. Every wall is visited from the
+ * cell to its south or west, plus the south and west boundaries.
+ */
+uint64_t zobristMaze(const maze_t *maze) {
+  uint64_t hash = 0;
+  int cell;
+  for (cell = 0; cell < MAZE_CELLS; cell++) {
+    hash ^= zobristWall(cell, NORTH, wallState(maze, cell, NORTH));
+    hash ^= zobristWall(cell, EAST, wallState(maze, cell, EAST));
+    if (CELL_Y(cell) == 0) {
+      hash ^= zobristWall(cell, SOUTH, wallState(maze, cell, SOUTH));
+    }
+    if (CELL_X(cell) == 0) {
+      hash ^= zobristWall(cell, WEST, wallState(maze, cell, WEST));
+    }
+  }
+  return hash;
+}
+
+/*
+ * The hash after mazeSetWall(maze, cell, heading, present). Call it
+ * before the wall is set, while the maze still has the old state.
+ */
+uint64_t zobristSetWall(uint64_t hash, const maze_t *maze, int cell, int heading, int present) {
+  hash ^= zobristWall(cell, heading, wallState(maze, cell, heading));
+  return hash ^ zobristWall(cell, heading, present ? 2 : 1);
+}
+
+uint64_t zobristPosition(int cell, int heading) {
+  return mix(0x8000000000000000ull | ((uint64_t) cell * 4 + (heading & 3)));
+}
+
+int transInit(transTable_t *table, int bits) {
+  memset(table, 0, sizeof (*table));
+  if (bits < 0 || bits > 24) {
+    return -1;
+  }
+  table->entries = calloc((size_t) 1 << bits, sizeof (transEntry_t));
+  if (table->entries == NULL) {
+    return -1;
+  }
+  table->mask = ((uint64_t) 1 << bits) - 1;
+  return 0;
+}
+
+void transFree(transTable_t *table) {
+  free(table->entries);
+  table->entries = NULL;
+}
+
+void transClear(transTable_t *table) {
+  memset(table->entries, 0, (size_t) (table->mask + 1) * sizeof (transEntry_t));
+  table->hits = 0;
+  table->misses = 0;
+  table->stores = 0;
+}
+
+const transEntry_t *transLookup(transTable_t *table, uint64_t key) {
+  const transEntry_t *entry = &table->entries[key & table->mask];
+  if (key != 0 && entry->key == key) {
+    table->hits++;
+    return entry;
+  }
+  table->misses++;
+  return NULL;
+}
+
+/*
+ * Routes and lists too long for an entry are not stored.
+ */
+void transStore(transTable_t *table, uint64_t key, const char *route, int nextHeading,
+        const COMMAND *commands, int count) {
+  transEntry_t *entry = &table->entries[key & table->mask];
+  size_t length = strlen(route);
+  if (key == 0 || length >= MAX_ROUTE || length > UINT8_MAX || count > COMMAND_LIST_SIZE) {
+    return;
+  }
+  entry->key = key;
+  entry->nextHeading = (int8_t) nextHeading;
+  entry->routeLength = (uint8_t) length;
+  entry->commandCount = (uint16_t) count;
+  memcpy(entry->route, route, length + 1);
+  memcpy(entry->commands, commands, (size_t) count * sizeof (COMMAND));
+  table->stores++;
+}
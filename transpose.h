@@ -0,0 +1,91 @@
+
+/*
+Copyright (c) 2014 Peter Harrison
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+ */
+
+#ifndef TRANSPOSE_H
+#define	TRANSPOSE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "commands.h"
+#include "maze.h"
+#include "flood.h"
+
+  /*
+   * A transposition table for the search. The route and the command list
+   * depend only on the known walls, the cell and the heading, so they are
+   * kept in a table keyed on a Zobrist hash of those and looked up before
+   * planning. One search never sees the same state twice, since that
+   * would be a loop, but a search that is restarted after a crash, or a
+   * second search of the same maze, does, and so do the first cells of
+   * mazes that open the same way.
+   *
+   * Each wall between two cells, and each boundary wall, is unknown,
+   * known open or known present. The hash is the XOR of a random key for
+   * the state of every known wall, so zobristSetWall() updates it in
+   * O(1) when a wall is seen. zobristPosition() adds the cell and
+   * heading. The keys are a fixed mix of the wall index rather than a
+   * table so that every thread and every run agrees on them.
+   *
+   * The table is direct mapped with 2^bits entries and a new result
+   * always replaces the old one in its slot. A key of zero marks an
+   * empty slot.
+   */
+
+  typedef struct {
+    uint64_t key;
+    int8_t nextHeading;
+    uint8_t routeLength;
+    uint16_t commandCount;
+    char route[MAX_ROUTE];
+    COMMAND commands[COMMAND_LIST_SIZE];
+  } transEntry_t;
+
+  typedef struct {
+    transEntry_t *entries;
+    uint64_t mask;
+    long hits;
+    long misses;
+    long stores;
+  } transTable_t;
+
+  uint64_t zobristWall(int cell, int heading, int state);
+  uint64_t zobristMaze(const maze_t *maze);
+  uint64_t zobristSetWall(uint64_t hash, const maze_t *maze, int cell, int heading, int present);
+  uint64_t zobristPosition(int cell, int heading);
+
+  int transInit(transTable_t *table, int bits);
+  void transFree(transTable_t *table);
+  void transClear(transTable_t *table);
+  const transEntry_t *transLookup(transTable_t *table, uint64_t key);
+  void transStore(transTable_t *table, uint64_t key, const char *route, int nextHeading,
+          const COMMAND *commands, int count);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRANSPOSE_H */
+